@@ -0,0 +1,145 @@
+#include "catch.hpp"
+
+#include "pool_algorithms.hpp"
+#include "stack_pool.hpp"
+#include "unrolled_stack_pool.hpp"
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+SCENARIO("walking many stacks at once"){
+  GIVEN("a pool with many stacks of different length"){
+    stack_pool<long, std::uint32_t> pool;
+    std::vector<std::uint32_t> heads(1000, pool.new_stack());
+    long expected = 0;
+    for(std::size_t i = 0; i < heads.size(); ++i)
+      for(std::size_t j = 0; j < i % 37; ++j){
+        heads[i] = pool.push(long(i * j), heads[i]);
+        expected += long(i * j);
+      }
+    auto sum = [](std::uint32_t, auto first, auto last){
+      return std::accumulate(first, last, 0L);
+    };
+    auto plus = [](long a, long b){ return a + b; };
+
+    THEN("the parallel reduction agrees with the sequential one"){
+      REQUIRE(transform_reduce_stacks(sequenced_policy{}, pool, heads, 0L, plus, sum) == expected);
+      for(unsigned threads : {1u, 2u, 4u, 7u})
+        REQUIRE(transform_reduce_stacks(parallel_policy{threads}, pool, heads, 0L, plus, sum)
+                == expected);
+    }
+
+    THEN("every stack is visited once"){
+      std::vector<std::atomic<int>> visits(pool.capacity() + 1);
+      for_each_stack(parallel_policy{4}, pool, heads, [&visits](std::uint32_t h, auto, auto){
+        ++visits[h];
+      });
+      for(auto h : heads)
+        REQUIRE(visits[h] == (h ? 1 : std::count(heads.begin(), heads.end(), 0u)));
+    }
+
+    THEN("an exception in a thread reaches the caller"){
+      const auto bad = heads[500];
+      REQUIRE_THROWS_AS(for_each_stack(parallel_policy{4}, pool, heads, [bad](std::uint32_t h, auto, auto){
+        if(h == bad)
+          throw std::runtime_error("stop");
+      }), std::runtime_error);
+    }
+  }
+
+  GIVEN("an unrolled pool"){
+    unrolled_stack_pool<int, 8, std::uint32_t> pool;
+    std::vector<std::uint32_t> heads(100, pool.new_stack());
+    for(auto& h : heads)
+      for(int j = 0; j < 20; ++j)
+        h = pool.push(j, h);
+    auto count = transform_reduce_stacks(parallel_policy{3}, pool, heads, std::size_t(0),
+        [](std::size_t a, std::size_t b){ return a + b; },
+        [](std::uint32_t, auto first, auto last){
+          return static_cast<std::size_t>(std::distance(first, last));
+        });
+    REQUIRE(count == 2000);
+  }
+}
+
+SCENARIO("walking stacks with prefetching"){
+  GIVEN("a stack whose nodes are shuffled"){
+    stack_pool<int, std::uint32_t> pool;
+    auto l = pool.new_stack();
+    for(int i = 0; i < 100; ++i)
+      l = pool.push(i, l);
+    // relink the nodes in the order 1, 38, 75, 12... (37 is coprime with 100)
+    l = 1;
+    for(std::uint32_t i = 0, x = 1; i < 100; ++i){
+      auto y = std::uint32_t((x - 1 + 37) % 100 + 1);
+      pool.next(x) = i == 99 ? pool.end() : y;
+      x = y;
+    }
+    std::vector<int> expected(pool.begin(l), pool.end(l));
+    REQUIRE(expected.size() == 100);
+    const std::vector<std::uint32_t> heads{l};
+
+    THEN("it visits the values in the order of the stack"){
+      std::vector<int> v;
+      for_each_stack_prefetch(pool, heads, [&](std::uint32_t h, int x){
+        REQUIRE(h == l);
+        v.push_back(x);
+      });
+      REQUIRE(v == expected);
+      int calls = 0;
+      for_each_stack_prefetch(pool, std::vector<std::uint32_t>{pool.new_stack()},
+                              [&](std::uint32_t, int){ ++calls; });
+      REQUIRE(calls == 0);
+    }
+
+    THEN("f can change the values, unless the pool is const"){
+      for_each_stack_prefetch(pool, heads, [](std::uint32_t, int& x){ x = -x; });
+      const auto& cpool = pool;
+      long sum = 0;
+      for_each_stack_prefetch(cpool, heads, [&](std::uint32_t, const int& x){ sum += x; });
+      REQUIRE(sum == -4950);
+    }
+  }
+
+  GIVEN("many stacks, some of them empty"){
+    stack_pool<int, std::uint32_t> pool;
+    std::vector<std::uint32_t> heads(50, pool.new_stack());
+    for(int i = 0; i < 1000; ++i){
+      auto k = (i * 7) % 50;
+      if(k % 5)
+        heads[k] = pool.push(i, heads[k]);
+    }
+
+    THEN("each stack is visited from the top, whatever the width"){
+      for(std::size_t w : {0, 1, 3, 8, 100}){
+        std::vector<std::vector<int>> seen(pool.capacity() + 1);
+        for_each_stack_prefetch(pool, heads, [&](std::uint32_t h, int x){
+          seen[h].push_back(x);
+        }, w);
+        std::size_t total = 0;
+        for(auto h : heads){
+          if(!h)
+            continue;
+          REQUIRE(seen[h] == std::vector<int>(pool.begin(h), pool.end(h)));
+          total += seen[h].size();
+        }
+        REQUIRE(total == 800);
+      }
+    }
+  }
+
+  GIVEN("a pool with soa_layout"){
+    stack_pool<double, std::uint16_t, vector_storage, soa_layout> pool;
+    auto l = pool.new_stack();
+    for(int i = 1; i <= 10; ++i)
+      l = pool.push(i, l);
+
+    THEN("values and nexts are read from their own arrays"){
+      double sum = 0;
+      for_each_stack_prefetch(pool, std::vector<std::uint16_t>{l},
+                              [&](std::uint16_t, double x){ sum += x; });
+      REQUIRE(sum == 55);
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+/*
+ * Batch ingest: many batches are pushed on their own stacks, then all
+ * the stacks are freed. Element by element with push and pop, or in
+ * bulk with push_range and free_stack, either on plain heads (freeing
+ * walks the stack to find its last node) or on stack_handles (freeing
+ * is O(1), as the handle knows its last node).
+ * The result is the time per element, in nanoseconds.
+ */
+constexpr std::size_t n_stacks = 1024;
+constexpr std::size_t rounds = 20;
+
+using pool_type = stack_pool<int, std::uint32_t>;
+
+template <typename Head, typename Fill, typename Free>
+double measure(std::size_t batch, Fill fill, Free release) {
+    std::vector<int> values(batch);
+    std::iota(values.begin(), values.end(), 0);
+    pool_type pool;
+    std::vector<Head> heads(n_stacks);
+    timer<> t;
+    t.start();
+    for(std::size_t r = 0; r < rounds; ++r){
+        for(auto& h : heads)
+            h = fill(pool, values, h);
+        for(auto& h : heads)
+            h = release(pool, h);
+    }
+    return t.elapsed() * 1e9 / (rounds * n_stacks * batch);
+}
+
+int main() {
+    std::cout << std::setw(10) << "batch" << std::setw(20) << "push+pop [ns/el]"
+              << std::setw(20) << "bulk [ns/el]" << std::setw(20) << "bulk handles" << std::endl;
+    for(std::size_t batch = 4; batch <= 4096; batch *= 4){
+        auto single = measure<std::uint32_t>(batch,
+            [](pool_type& p, const std::vector<int>& v, std::uint32_t h){
+                for(auto x : v)
+                    h = p.push(x, h);
+                return h;
+            },
+            [](pool_type& p, std::uint32_t h){
+                while(h) h = p.pop(h);
+                return h;
+            });
+        auto bulk = measure<std::uint32_t>(batch,
+            [](pool_type& p, const std::vector<int>& v, std::uint32_t h){
+                return p.push_range(v.begin(), v.end(), h);
+            },
+            [](pool_type& p, std::uint32_t h){
+                return p.free_stack(h);
+            });
+        auto handles = measure<pool_type::handle_type>(batch,
+            [](pool_type& p, const std::vector<int>& v, const pool_type::handle_type& h){
+                return p.push_range(v.begin(), v.end(), h);
+            },
+            [](pool_type& p, const pool_type::handle_type& h){
+                return p.free_stack(h);
+            });
+        std::cout << std::setw(10) << batch << std::setw(20) << single
+                  << std::setw(20) << bulk << std::setw(20) << handles << std::endl;
+    }
+}
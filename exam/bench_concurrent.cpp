@@ -0,0 +1,85 @@
+#include "concurrent_stack_pool.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Every thread fills n_stacks stacks of its own and then empties them,
+ * so the only thing shared among the threads is the pool.
+ * The result is the throughput, in millions of push+pop per second.
+ */
+constexpr std::size_t n_stacks = 16;
+constexpr std::size_t depth = 256;
+constexpr std::size_t rounds = 200;
+
+using stack_type = std::uint32_t;
+
+struct locked_pool {
+    std::mutex m;
+    stack_pool<int, stack_type> pool;
+    stack_type push(int v, stack_type head) {
+        std::lock_guard<std::mutex> lock{m};
+        return pool.push(v, head);
+    }
+    stack_type pop(stack_type x) {
+        std::lock_guard<std::mutex> lock{m};
+        return pool.pop(x);
+    }
+};
+
+template <typename F>
+double run(unsigned n_threads, F work) {
+    std::vector<std::thread> workers;
+    timer<> t;
+    t.start();
+    for(unsigned i = 0; i < n_threads; ++i)
+        workers.emplace_back(work);
+    for(auto& w : workers)
+        w.join();
+    auto s = t.elapsed();
+    return 2.0 * n_threads * n_stacks * depth * rounds / s / 1e6;
+}
+
+int main() {
+    unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << std::setw(10) << "threads" << std::setw(20) << "concurrent [Mop/s]"
+              << std::setw(20) << "mutex [Mop/s]" << std::endl;
+
+    for(unsigned n = 1; n <= max_threads; n *= 2){
+        // the caches of the other threads may hold batch_size-1 free nodes each
+        using pool_type = concurrent_stack_pool<int, stack_type>;
+        pool_type cpool{n * n_stacks * depth + (n - 1) * (pool_type::batch_size - 1)};
+        auto lock_free = run(n, [&cpool]{
+            concurrent_stack_pool<int, stack_type>::thread_cache cache{cpool};
+            std::vector<stack_type> heads(n_stacks, cpool.new_stack());
+            for(std::size_t r = 0; r < rounds; ++r){
+                for(auto& h : heads)
+                    for(std::size_t i = 0; i < depth; ++i)
+                        h = cpool.push(int(i), h, cache);
+                for(auto& h : heads)
+                    while(h) h = cpool.pop(h, cache);
+            }
+        });
+
+        locked_pool lpool;
+        lpool.pool.reserve(n * n_stacks * depth);
+        auto locked = run(n, [&lpool]{
+            std::vector<stack_type> heads(n_stacks, lpool.pool.new_stack());
+            for(std::size_t r = 0; r < rounds; ++r){
+                for(auto& h : heads)
+                    for(std::size_t i = 0; i < depth; ++i)
+                        h = lpool.push(int(i), h);
+                for(auto& h : heads)
+                    while(h) h = lpool.pop(h);
+            }
+        });
+
+        std::cout << std::setw(10) << n << std::setw(20) << lock_free
+                  << std::setw(20) << locked << std::endl;
+    }
+}
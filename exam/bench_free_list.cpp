@@ -0,0 +1,89 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+ * The free-list policies under churn.
+ * n_stacks stacks are filled with n_nodes values in total, one stack
+ * after the other, and a quarter of the values are popped from random
+ * stacks. Then for n_churn steps a few values are popped from a random
+ * stack and as many are pushed on another one, so that there are always
+ * free nodes to choose from. Finally every stack is scanned.
+ * The results are in nanoseconds per value pushed or popped during
+ * the churn and per value scanned.
+ */
+constexpr std::size_t n_stacks = 1 << 12;
+constexpr std::size_t n_nodes = std::size_t(1) << 22;
+constexpr std::size_t n_churn = std::size_t(1) << 20;
+constexpr std::size_t scans = 5;
+
+template <typename FreeList>
+void measure(const char* name) {
+    using pool_type = stack_pool<int, std::uint32_t, vector_storage, aos_layout,
+                                 std::allocator<int>, no_stats, FreeList>;
+    pool_type pool;
+    std::vector<std::uint32_t> heads(n_stacks, pool.new_stack());
+    std::vector<std::size_t> sizes(n_stacks, 0);
+    std::mt19937 gen{3};
+    std::uniform_int_distribution<std::size_t> stack{0, n_stacks - 1};
+    std::uniform_int_distribution<std::size_t> burst{1, 32};
+
+    for(std::size_t i = 0; i < n_nodes; ++i){
+        auto s = i / (n_nodes / n_stacks); // the stacks are filled one after the other
+        heads[s] = pool.push(int(i), heads[s]);
+        ++sizes[s];
+    }
+
+    for(std::size_t n = 0; n < n_nodes / 4;){
+        auto s = stack(gen);
+        auto k = std::min(burst(gen), sizes[s]);
+        heads[s] = pool.pop_n(heads[s], k);
+        sizes[s] -= k;
+        n += k;
+    }
+
+    timer<> t;
+    std::size_t moved = 0;
+    t.start();
+    for(std::size_t i = 0; i < n_churn; ++i){
+        auto from = stack(gen), to = stack(gen);
+        auto k = std::min(burst(gen), sizes[from]);
+        for(std::size_t j = 0; j < k; ++j)
+            heads[from] = pool.pop(heads[from]);
+        for(std::size_t j = 0; j < k; ++j)
+            heads[to] = pool.push(int(j), heads[to]);
+        sizes[from] -= k;
+        sizes[to] += k;
+        moved += k;
+    }
+    double t_churn = t.elapsed();
+
+    long sum = 0;
+    t.start();
+    for(std::size_t r = 0; r < scans; ++r)
+        for(auto h : heads)
+            for(auto x : pool.stack(h))
+                sum += x;
+    double t_scan = t.elapsed();
+    std::size_t values = 0;
+    for(auto n : sizes)
+        values += n;
+
+    std::cout << std::setw(20) << name << std::setw(14) << t_churn * 1e9 / (2 * moved)
+              << std::setw(14) << t_scan * 1e9 / (scans * values) << std::setw(14)
+              << pool.capacity() << "   (" << sum % 10 << ")" << std::endl;
+}
+
+int main() {
+    std::cout << std::setw(20) << "free list" << std::setw(14) << "churn [ns]"
+              << std::setw(14) << "scan [ns]" << std::setw(14) << "nodes" << std::endl;
+    measure<lifo_free_list>("lifo");
+    measure<ordered_free_list>("ordered");
+    measure<near_head_free_list<64>>("near head, 64 B");
+    measure<near_head_free_list<4096>>("near head, 4 KiB");
+}
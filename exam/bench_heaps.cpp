@@ -0,0 +1,127 @@
+#include "heap_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+
+/*
+ * One small priority queue per tenant: the operations go to random
+ * tenants, two pushes every pop, then all the queues are drained.
+ * heap_pool keeps all the heaps in the same nodes, against a vector
+ * of std::priority_queue, each with its own buffer.
+ * The results are in nanoseconds per operation; the memory is the
+ * capacity of the containers, in bytes per value still queued at the
+ * end of the first phase (the overhead of malloc for every buffer
+ * of priority_queue is not counted).
+ * With few tenants each queue holds tens of values; with many, most
+ * queues hold one or two.
+ */
+constexpr std::size_t n_ops = std::size_t(1) << 22;
+constexpr std::size_t rounds = 3;
+
+struct op {
+    std::uint32_t tenant;
+    int value;
+};
+
+std::vector<op> make_ops(std::uint32_t n_tenants) {
+    std::mt19937 gen{1};
+    std::uniform_int_distribution<std::uint32_t> tenant{0, n_tenants - 1};
+    std::uniform_int_distribution<int> value;
+    std::vector<op> ops(n_ops);
+    for(auto& o : ops)
+        o = {tenant(gen), value(gen)};
+    return ops;
+}
+
+void print(const char* name, double t_ops, double t_drain, double bytes, long sum) {
+    std::cout << std::setw(16) << name << std::setw(12) << t_ops * 1e9 / (rounds * n_ops)
+              << std::setw(12) << t_drain * 1e9 / (rounds * n_ops) << std::setw(12) << bytes
+              << "   (" << sum % 10 << ")" << std::endl;
+}
+
+void measure_priority_queue(std::size_t n_tenants, const std::vector<op>& ops) {
+    double t_ops = 0, t_drain = 0, bytes = 0;
+    long sum = 0;
+    timer<> t;
+    for(std::size_t r = 0; r < rounds; ++r){
+        std::vector<std::priority_queue<int>> queues(n_tenants);
+        t.start();
+        std::size_t i = 0;
+        for(auto& o : ops){
+            auto& q = queues[o.tenant];
+            if(++i % 3 == 0 && !q.empty()){
+                sum += q.top();
+                q.pop();
+            }else
+                q.push(o.value);
+        }
+        t_ops += t.elapsed();
+        std::size_t values = 0, capacity = 0;
+        for(auto& q : queues)
+            values += q.size();
+        // the capacity of the protected container of priority_queue
+        struct peek : std::priority_queue<int> {
+            static std::size_t capacity(const std::priority_queue<int>& q) {
+                return (q.*&peek::c).capacity();
+            }
+        };
+        for(auto& q : queues)
+            capacity += peek::capacity(q);
+        bytes = double(capacity * sizeof(int) + n_tenants * sizeof(queues[0])) / values;
+        t.start();
+        for(auto& q : queues)
+            for(; !q.empty(); q.pop())
+                sum += q.top();
+        t_drain += t.elapsed();
+    }
+    print("priority_queue", t_ops, t_drain, bytes, sum);
+}
+
+template <typename N>
+void measure_heap_pool(const char* name, std::size_t n_tenants, const std::vector<op>& ops) {
+    double t_ops = 0, t_drain = 0, bytes = 0;
+    long sum = 0;
+    timer<> t;
+    for(std::size_t r = 0; r < rounds; ++r){
+        heap_pool<int, std::less<int>, N> pool;
+        std::vector<N> heaps(n_tenants, pool.new_heap());
+        t.start();
+        std::size_t i = 0, values = 0;
+        for(auto& o : ops){
+            auto& h = heaps[o.tenant];
+            if(++i % 3 == 0 && !pool.empty(h)){
+                sum += pool.top(h);
+                h = pool.pop(h);
+                --values;
+            }else{
+                h = pool.push(o.value, h);
+                ++values;
+            }
+        }
+        t_ops += t.elapsed();
+        bytes = double(pool.capacity() * sizeof(heap_node<int, N>) + n_tenants * sizeof(N))
+                / values;
+        t.start();
+        for(auto& h : heaps)
+            for(; !pool.empty(h); h = pool.pop(h))
+                sum += pool.top(h);
+        t_drain += t.elapsed();
+    }
+    print(name, t_ops, t_drain, bytes, sum);
+}
+
+int main() {
+    for(std::uint32_t n_tenants : {1u << 16, 1u << 20}){
+        auto ops = make_ops(n_tenants);
+        std::cout << n_tenants << " tenants, " << n_ops << " operations" << std::endl;
+        std::cout << std::setw(16) << "" << std::setw(12) << "ops [ns]" << std::setw(12)
+                  << "drain [ns]" << std::setw(12) << "[B/value]" << std::endl;
+        measure_priority_queue(n_tenants, ops);
+        measure_heap_pool<std::size_t>("heap_pool", n_tenants, ops);
+        measure_heap_pool<std::uint32_t>("heap_pool<u32>", n_tenants, ops);
+    }
+}
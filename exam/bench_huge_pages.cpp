@@ -0,0 +1,81 @@
+#include "huge_page_storage.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * A pool far larger than what the TLB can map with 4 KiB pages, with
+ * one stack relinked in a random order: every step of a traversal goes
+ * to a random page. The same pool is built with vector_storage and
+ * with huge_page_storage, with and without pre-faulted pages.
+ * The results are in nanoseconds per node for filling the pool and for
+ * walking the stack; the difference in the walks is the cost of the TLB
+ * misses (the cache misses are the same). AnonHugePages is the memory
+ * backed by transparent huge pages while the pool is alive.
+ */
+constexpr std::size_t n_nodes = std::size_t(1) << 26;
+constexpr std::size_t walks = 3;
+
+std::size_t anon_huge_pages_kb() {
+    std::ifstream meminfo{"/proc/meminfo"};
+    std::string key;
+    std::size_t value = 0;
+    while(meminfo >> key){
+        if(key == "AnonHugePages:" && meminfo >> value)
+            return value;
+        meminfo.ignore(256, '\n');
+    }
+    return 0;
+}
+
+template <typename Storage>
+void measure(const char* name, const std::vector<std::uint32_t>& order) {
+    const auto huge_before = anon_huge_pages_kb();
+    timer<> t;
+    t.start();
+    stack_pool<std::uint32_t, std::uint32_t, Storage> pool;
+    auto l = pool.new_stack();
+    for(std::size_t i = 0; i < n_nodes; ++i)
+        l = pool.push(std::uint32_t(i), l);
+    double t_fill = t.elapsed();
+
+    for(std::size_t i = 0; i + 1 < n_nodes; ++i)
+        pool.next_unchecked(order[i]) = order[i + 1];
+    pool.next_unchecked(order.back()) = pool.end();
+    l = order.front();
+    const auto huge = anon_huge_pages_kb() - std::min(huge_before, anon_huge_pages_kb());
+
+    std::uint64_t sum = 0;
+    t.start();
+    for(std::size_t r = 0; r < walks; ++r)
+        for(auto x : pool.stack(l))
+            sum += x;
+    double t_walk = t.elapsed();
+
+    std::cout << std::setw(20) << name << std::setw(12) << t_fill * 1e9 / n_nodes
+              << std::setw(12) << t_walk * 1e9 / (walks * n_nodes) << std::setw(14)
+              << huge / 1024 << "   (" << sum % 10 << ")" << std::endl;
+}
+
+int main() {
+    std::vector<std::uint32_t> order(n_nodes);
+    std::iota(order.begin(), order.end(), 1);
+    std::shuffle(order.begin(), order.end(), std::mt19937{7});
+
+    std::cout << n_nodes << " nodes, "
+              << n_nodes * sizeof(aos_node<std::uint32_t, std::uint32_t>) / (1 << 20) << " MiB"
+              << std::endl;
+    std::cout << std::setw(20) << "storage" << std::setw(12) << "fill [ns]" << std::setw(12)
+              << "walk [ns]" << std::setw(14) << "huge [MiB]" << std::endl;
+    measure<vector_storage>("vector", order);
+    measure<huge_page_storage<>>("huge pages", order);
+    measure<huge_page_storage<true>>("huge pages, populate", order);
+}
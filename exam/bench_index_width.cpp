@@ -0,0 +1,55 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+
+/*
+ * Traversal time and memory per node for 1, 2, 4 and 8-byte addresses.
+ * The stack is sorted on random keys first, so that its nodes are
+ * visited in random order, as in a pool that has been used for a while.
+ * Each size is measured with the index types that can address it:
+ * a uint8_t pool cannot have more than 255 nodes.
+ */
+constexpr std::size_t total_visits = std::size_t(1) << 26;
+
+template <typename N>
+void measure(const char* name, std::size_t n_nodes) {
+    if(n_nodes > std::numeric_limits<N>::max())
+        return;
+    stack_pool<std::uint16_t, N> pool{n_nodes};
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<std::uint16_t> key;
+    auto l = pool.new_stack();
+    for(std::size_t i = 0; i < n_nodes; ++i)
+        l = pool.push(key(gen), l);
+    l = pool.sort(l);
+
+    const std::size_t rounds = total_visits / n_nodes;
+    std::size_t sum = 0;
+    timer<> t;
+    t.start();
+    for(std::size_t r = 0; r < rounds; ++r)
+        for(auto x = l; x; x = pool.next_unchecked(x))
+            sum += pool.value_unchecked(x);
+    auto elapsed = t.elapsed();
+    std::cout << std::setw(10) << name << std::setw(10) << n_nodes
+              << std::setw(14) << sizeof(aos_node<std::uint16_t, N>)
+              << std::setw(16) << pool.capacity() * sizeof(aos_node<std::uint16_t, N>) / 1024
+              << std::setw(14) << elapsed * 1e9 / (rounds * n_nodes)
+              << "   (" << sum % 10 << ")" << std::endl;
+}
+
+int main() {
+    std::cout << std::setw(10) << "N" << std::setw(10) << "nodes"
+              << std::setw(14) << "node [B]" << std::setw(16) << "pool [KiB]"
+              << std::setw(14) << "[ns/node]" << std::endl;
+    for(std::size_t n : {std::size_t(255), std::size_t(65535), std::size_t(1) << 20}){
+        measure<std::uint8_t>("uint8_t", n);
+        measure<std::uint16_t>("uint16_t", n);
+        measure<std::uint32_t>("uint32_t", n);
+        measure<std::uint64_t>("uint64_t", n);
+    }
+}
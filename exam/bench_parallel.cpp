@@ -0,0 +1,59 @@
+#include "pool_algorithms.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+/*
+ * Sum of the values of many stacks of random length, walked in
+ * parallel with transform_reduce_stacks on 1, 2, 4... threads,
+ * up to the number of cores. The nodes of the stacks are interleaved,
+ * so every walk is a chain of cache misses: it should scale with the
+ * number of cores until the memory bandwidth is saturated.
+ */
+constexpr std::size_t n_stacks = 200000;
+constexpr std::size_t rounds = 5;
+
+int main() {
+    stack_pool<long, std::uint32_t> pool;
+    std::vector<std::uint32_t> heads(n_stacks, pool.new_stack());
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<std::size_t> stack_of(0, n_stacks - 1);
+    for(std::size_t i = 0; i < n_stacks * 64; ++i){
+        auto& h = heads[stack_of(gen)];
+        h = pool.push(long(i), h);
+    }
+
+    auto plus = [](long a, long b){ return a + b; };
+    auto sum = [](std::uint32_t, auto first, auto last){
+        return std::accumulate(first, last, 0L);
+    };
+
+    timer<> t;
+    t.start();
+    long expected = 0;
+    for(std::size_t r = 0; r < rounds; ++r)
+        expected = transform_reduce_stacks(sequenced_policy{}, pool, heads, 0L, plus, sum);
+    const double serial = t.elapsed() / rounds;
+
+    std::cout << std::setw(10) << "threads" << std::setw(14) << "time [ms]"
+              << std::setw(12) << "speedup" << std::endl;
+    std::cout << std::setw(10) << "serial" << std::setw(14) << serial * 1e3
+              << std::setw(12) << 1.0 << std::endl;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned threads = 1; threads <= cores; threads *= 2){
+        long result = 0;
+        t.start();
+        for(std::size_t r = 0; r < rounds; ++r)
+            result = transform_reduce_stacks(parallel_policy{threads}, pool, heads, 0L, plus, sum);
+        const double elapsed = t.elapsed() / rounds;
+        std::cout << std::setw(10) << threads << std::setw(14) << elapsed * 1e3
+                  << std::setw(12) << serial / elapsed
+                  << (result == expected ? "" : "   wrong result!") << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <numeric>
+
+/*
+ * Short-lived pools: a pool is created, a few stacks are filled and
+ * read, then the pool is thrown away. With a monotonic_buffer_resource
+ * on a local buffer all the growth of the pool is a pointer bump and
+ * the destruction releases nothing.
+ * The result is the time per pool, in nanoseconds.
+ */
+constexpr std::size_t n_pools = 100000;
+constexpr std::size_t n_stacks = 8;
+
+template <typename Pool, typename Make>
+double measure(std::size_t depth, Make make) {
+    long long sum = 0;
+    timer<> t;
+    t.start();
+    for(std::size_t p = 0; p < n_pools; ++p){
+        std::array<std::byte, 1 << 16> buffer;
+        std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size()};
+        Pool pool = make(arena);
+        std::array<std::uint32_t, n_stacks> heads{};
+        for(std::size_t i = 0; i < depth; ++i)
+            for(auto& h : heads)
+                h = pool.push(int(i), h);
+        for(auto h : heads)
+            sum += std::accumulate(pool.begin(h), pool.end(h), 0LL);
+    }
+    auto s = t.elapsed();
+    if(sum == 42)
+        std::cout << ""; // keep the work alive
+    return s * 1e9 / n_pools;
+}
+
+int main() {
+    using std_pool = stack_pool<int, std::uint32_t>;
+    using pmr_pool = pmr::stack_pool<int, std::uint32_t>;
+    std::cout << std::setw(10) << "nodes" << std::setw(22) << "std::allocator [ns]"
+              << std::setw(22) << "monotonic [ns]" << std::endl;
+    for(std::size_t depth = 4; depth <= 256; depth *= 4){
+        auto a = measure<std_pool>(depth, [](auto&){ return std_pool{}; });
+        auto b = measure<pmr_pool>(depth, [](auto& arena){ return pmr_pool{&arena}; });
+        std::cout << std::setw(10) << depth * n_stacks << std::setw(22) << a
+                  << std::setw(22) << b << std::endl;
+    }
+}
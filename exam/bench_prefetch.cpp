@@ -0,0 +1,84 @@
+#include "pool_algorithms.hpp"
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Traversals of a deliberately shuffled pool: n_nodes nodes relinked
+ * in a random order into n_stacks stacks, so that every step jumps to
+ * a random place of a pool larger than the last-level cache.
+ *
+ * The stacks are walked one after the other with a range-for, then all
+ * together with for_each_stack_prefetch at several widths (width 1 is
+ * a walk with one prefetch ahead). Each traversal is made with a cheap
+ * f (a sum) and with an f that does some arithmetic on every value.
+ * The results are in nanoseconds per node.
+ */
+constexpr std::size_t n_nodes = std::size_t(1) << 25;
+constexpr std::size_t n_stacks = 1 << 10;
+
+/*
+ * About 10 ns of dependent multiplications.
+ */
+inline std::uint64_t work(std::uint64_t x) noexcept {
+    for(int i = 0; i < 8; ++i)
+        x = x * 0x9E3779B97F4A7C15ull + 1;
+    return x;
+}
+
+template <typename Walk>
+void measure(const std::string& name, Walk walk) {
+    timer<> t;
+    std::uint64_t cheap = 0, heavy = 0;
+    t.start();
+    walk([&](std::uint32_t x){ cheap += x; });
+    double t_cheap = t.elapsed();
+    t.start();
+    walk([&](std::uint32_t x){ heavy += work(x); });
+    double t_heavy = t.elapsed();
+    std::cout << std::setw(20) << name << std::setw(14) << t_cheap * 1e9 / n_nodes
+              << std::setw(14) << t_heavy * 1e9 / n_nodes << "   (" << (cheap + heavy) % 10
+              << ")" << std::endl;
+}
+
+int main() {
+    stack_pool<std::uint32_t, std::uint32_t> pool;
+    pool.reserve(n_nodes);
+    auto l = pool.new_stack();
+    for(std::size_t i = 0; i < n_nodes; ++i)
+        l = pool.push(std::uint32_t(i), l);
+    std::vector<std::uint32_t> heads(n_stacks);
+    {
+        std::vector<std::uint32_t> order(n_nodes);
+        std::iota(order.begin(), order.end(), 1);
+        std::shuffle(order.begin(), order.end(), std::mt19937{5});
+        const std::size_t length = n_nodes / n_stacks;
+        for(std::size_t i = 0; i < n_nodes; ++i)
+            pool.next_unchecked(order[i]) = (i + 1) % length ? order[i + 1] : pool.end();
+        for(std::size_t s = 0; s < n_stacks; ++s)
+            heads[s] = order[s * length];
+    }
+
+    std::cout << n_stacks << " stacks, " << n_nodes << " shuffled nodes, "
+              << n_nodes * sizeof(aos_node<std::uint32_t, std::uint32_t>) / (1 << 20) << " MiB"
+              << std::endl;
+    std::cout << std::setw(20) << "" << std::setw(14) << "sum [ns]" << std::setw(14)
+              << "work [ns]" << std::endl;
+    measure("range-for", [&](auto f){
+        for(auto h : heads)
+            for(auto x : pool.stack(h))
+                f(x);
+    });
+    for(std::size_t w : {1, 2, 4, 8, 16, 32}){
+        measure("stacks prefetch " + std::to_string(w), [&](auto f){
+            for_each_stack_prefetch(pool, heads, [&](std::uint32_t, std::uint32_t x){ f(x); }, w);
+        });
+    }
+}
@@ -0,0 +1,48 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+ * Latency of every single push on a pool that starts empty,
+ * so that the growth of the storage happens during the measure.
+ * The values are big enough to make the relocation of the nodes
+ * visible in the tail of the distribution.
+ */
+struct big {
+    char payload[256];
+    explicit big(int i) noexcept { payload[0] = char(i); }
+};
+
+constexpr std::size_t n_push = 1 << 20;
+
+template <typename Storage>
+void measure(const char* name) {
+    std::vector<double> lat(n_push);
+    stack_pool<big, std::uint32_t, Storage> pool;
+    auto l = pool.new_stack();
+    timer<> t;
+    for(std::size_t i = 0; i < n_push; ++i){
+        t.start();
+        l = pool.push(big{int(i)}, l);
+        lat[i] = t.elapsed() * 1e9;
+    }
+    std::sort(lat.begin(), lat.end());
+    auto pct = [&lat](double p){ return lat[std::size_t(p * (lat.size() - 1))]; };
+    std::cout << std::setw(12) << name
+              << std::setw(12) << pct(0.5)
+              << std::setw(12) << pct(0.99)
+              << std::setw(12) << pct(0.999)
+              << std::setw(14) << lat.back() << std::endl;
+}
+
+int main() {
+    std::cout << std::setw(12) << "storage" << std::setw(12) << "p50 [ns]"
+              << std::setw(12) << "p99 [ns]" << std::setw(12) << "p999 [ns]"
+              << std::setw(14) << "max [ns]" << std::endl;
+    measure<vector_storage>("vector");
+    measure<chunked_storage<10>>("chunked");
+}
@@ -0,0 +1,124 @@
+#include "deque_pool.hpp"
+#include "queue_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <queue>
+
+/*
+ * Many short-lived queues, as in a breadth-first search or a work list:
+ * each round creates n_queues queues, fills each of them with a few
+ * values, then drains them, so that the standard containers allocate
+ * and free a block per queue while the pools reuse their nodes.
+ * The results are in nanoseconds per value (push + pop).
+ */
+constexpr std::size_t n_queues = 1 << 20;
+constexpr std::size_t values_per_queue = 8;
+constexpr std::size_t rounds = 5;
+
+void print(const char* name, double t, long sum) {
+    const double n = double(rounds) * n_queues * values_per_queue;
+    std::cout << std::setw(16) << name << std::setw(14) << t * 1e9 / n
+              << "   (" << sum % 10 << ")" << std::endl;
+}
+
+template <typename Q>
+void measure_std(const char* name) {
+    long sum = 0;
+    timer<> t;
+    t.start();
+    for(std::size_t r = 0; r < rounds; ++r){
+        for(std::size_t q = 0; q < n_queues; ++q){
+            Q queue;
+            for(std::size_t i = 0; i < values_per_queue; ++i)
+                queue.push(int(q + i));
+            while(!queue.empty()){
+                sum += queue.front();
+                queue.pop();
+            }
+        }
+    }
+    print(name, t.elapsed(), sum);
+}
+
+void measure_queue_pool() {
+    long sum = 0;
+    timer<> t;
+    t.start();
+    queue_pool<int, std::uint32_t> pool;
+    for(std::size_t r = 0; r < rounds; ++r){
+        for(std::size_t q = 0; q < n_queues; ++q){
+            auto queue = pool.new_queue();
+            for(std::size_t i = 0; i < values_per_queue; ++i)
+                queue = pool.push_back(int(q + i), queue);
+            while(!pool.empty(queue)){
+                sum += pool.front(queue);
+                queue = pool.pop_front(queue);
+            }
+        }
+    }
+    print("queue_pool", t.elapsed(), sum);
+}
+
+/*
+ * Half of the values go in at the front, half at the back.
+ */
+void measure_std_deque() {
+    long sum = 0;
+    timer<> t;
+    t.start();
+    for(std::size_t r = 0; r < rounds; ++r){
+        for(std::size_t q = 0; q < n_queues; ++q){
+            std::deque<int> d;
+            for(std::size_t i = 0; i < values_per_queue; i += 2){
+                d.push_back(int(q + i));
+                d.push_front(int(q + i + 1));
+            }
+            while(!d.empty()){
+                sum += d.back();
+                d.pop_back();
+                sum += d.front();
+                d.pop_front();
+            }
+        }
+    }
+    print("std::deque", t.elapsed(), sum);
+}
+
+void measure_deque_pool() {
+    long sum = 0;
+    timer<> t;
+    t.start();
+    deque_pool<int, std::uint32_t> pool;
+    for(std::size_t r = 0; r < rounds; ++r){
+        for(std::size_t q = 0; q < n_queues; ++q){
+            auto d = pool.new_deque();
+            for(std::size_t i = 0; i < values_per_queue; i += 2){
+                d = pool.push_back(int(q + i), d);
+                d = pool.push_front(int(q + i + 1), d);
+            }
+            while(!pool.empty(d)){
+                sum += pool.back(d);
+                d = pool.pop_back(d);
+                sum += pool.front(d);
+                d = pool.pop_front(d);
+            }
+        }
+    }
+    print("deque_pool", t.elapsed(), sum);
+}
+
+int main() {
+    std::cout << n_queues << " queues of " << values_per_queue << " values, "
+              << rounds << " rounds" << std::endl;
+    std::cout << std::setw(16) << "FIFO" << std::setw(14) << "[ns/value]" << std::endl;
+    measure_std<std::queue<int>>("std::queue");
+    measure_std<std::queue<int, std::list<int>>>("std::queue<list>");
+    measure_queue_pool();
+    std::cout << std::setw(16) << "both ends" << std::setw(14) << "[ns/value]" << std::endl;
+    measure_std_deque();
+    measure_deque_pool();
+}
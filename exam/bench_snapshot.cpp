@@ -0,0 +1,63 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+/*
+ * Checkpoint and reload of a pool through a file: save and load
+ * against rebuilding the same stacks with push. The file is likely
+ * in the page cache, so the load measures the cost on our side;
+ * from a disk the bandwidth of the disk is the bound.
+ */
+constexpr std::size_t n_nodes = std::size_t(1) << 24;
+constexpr std::size_t n_stacks = 64;
+
+using pool_type = stack_pool<std::uint64_t, std::uint32_t>;
+
+int main() {
+    const std::string path = "/tmp/bench_snapshot." + std::to_string(::getpid());
+    pool_type pool;
+    std::uint32_t heads[n_stacks] = {};
+    for(std::size_t i = 0; i < n_nodes; ++i)
+        heads[i % n_stacks] = pool.push(i, heads[i % n_stacks]);
+    const double mb = double(n_nodes * sizeof(aos_node<std::uint64_t, std::uint32_t>)) / (1 << 20);
+
+    timer<> t;
+    t.start();
+    {
+        std::ofstream os{path, std::ios::binary};
+        pool.save(os);
+    }
+    auto t_save = t.elapsed();
+
+    pool_type loaded;
+    t.start();
+    {
+        std::ifstream is{path, std::ios::binary};
+        loaded.load(is);
+    }
+    auto t_load = t.elapsed();
+
+    pool_type rebuilt;
+    std::uint32_t rebuilt_heads[n_stacks] = {};
+    t.start();
+    for(std::size_t i = 0; i < n_nodes; ++i)
+        rebuilt_heads[i % n_stacks] = rebuilt.push(i, rebuilt_heads[i % n_stacks]);
+    auto t_push = t.elapsed();
+    std::remove(path.c_str());
+
+    std::cout << std::setw(10) << "nodes" << std::setw(12) << "MiB"
+              << std::setw(14) << "save [MB/s]" << std::setw(14) << "load [MB/s]"
+              << std::setw(14) << "push [MB/s]" << std::endl;
+    std::cout << std::setw(10) << n_nodes << std::setw(12) << mb
+              << std::setw(14) << mb / t_save << std::setw(14) << mb / t_load
+              << std::setw(14) << mb / t_push
+              << "   (" << (loaded.value(heads[0]) == rebuilt.value(rebuilt_heads[0])) << ")"
+              << std::endl;
+}
@@ -0,0 +1,98 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/*
+ * Checked against unchecked accessors, compiled with -DNDEBUG
+ * (see the Makefile) so that the assertions of the unchecked tier
+ * are gone: a long stack is walked with value and next, summing
+ * its values, then it is emptied with pop. The check is one branch
+ * that is never taken, hidden behind the latency of the next node.
+ * Where it is on the critical path it shows: a small pool, in cache,
+ * is read with value at random addresses, which do not depend on
+ * each other.
+ * The result is the time per operation, in nanoseconds.
+ */
+constexpr std::size_t n_nodes = 1 << 20;
+constexpr std::size_t rounds = 20;
+constexpr std::size_t n_small = 1 << 12;
+constexpr std::size_t n_reads = 1 << 16;
+constexpr std::size_t read_rounds = 1000;
+
+using pool_type = stack_pool<long, std::uint32_t>;
+
+template <typename Walk, typename Pop, typename Read>
+void measure(const char* name, Walk walk, Pop pop, Read read) {
+    pool_type pool{n_nodes};
+    long sum = 0;
+    double t_walk = 0, t_pop = 0;
+    timer<> t;
+    for(std::size_t r = 0; r < rounds; ++r){
+        auto l = pool.new_stack();
+        for(std::size_t i = 0; i < n_nodes; ++i)
+            l = pool.push(long(i), l);
+        t.start();
+        sum += walk(pool, l);
+        t_walk += t.elapsed();
+        t.start();
+        while(l) l = pop(pool, l);
+        t_pop += t.elapsed();
+    }
+
+    pool_type small{n_small};
+    auto l = small.new_stack();
+    for(std::size_t i = 0; i < n_small; ++i)
+        l = small.push(long(i), l);
+    std::mt19937 gen{1};
+    std::uniform_int_distribution<std::uint32_t> node{1, n_small};
+    std::vector<std::uint32_t> addresses(n_reads);
+    for(auto& x : addresses)
+        x = node(gen);
+    t.start();
+    for(std::size_t r = 0; r < read_rounds; ++r)
+        sum += read(small, addresses);
+    double t_read = t.elapsed();
+
+    std::cout << std::setw(12) << name
+              << std::setw(16) << t_walk * 1e9 / (rounds * n_nodes)
+              << std::setw(16) << t_pop * 1e9 / (rounds * n_nodes)
+              << std::setw(16) << t_read * 1e9 / (read_rounds * n_reads)
+              << "   (" << sum << ")" << std::endl;
+}
+
+int main() {
+    std::cout << std::setw(12) << "accessors" << std::setw(16) << "walk [ns/el]"
+              << std::setw(16) << "pop [ns/el]" << std::setw(16) << "reads [ns/el]" << std::endl;
+    measure("checked",
+        [](pool_type& p, std::uint32_t x){
+            long s = 0;
+            for(; x; x = p.next(x))
+                s += p.value(x);
+            return s;
+        },
+        [](pool_type& p, std::uint32_t x){ return p.pop(x); },
+        [](pool_type& p, const std::vector<std::uint32_t>& v){
+            long s = 0;
+            for(auto x : v)
+                s += p.value(x);
+            return s;
+        });
+    measure("unchecked",
+        [](pool_type& p, std::uint32_t x){
+            long s = 0;
+            for(; x; x = p.next_unchecked(x))
+                s += p.value_unchecked(x);
+            return s;
+        },
+        [](pool_type& p, std::uint32_t x){ return p.pop_unchecked(x); },
+        [](pool_type& p, const std::vector<std::uint32_t>& v){
+            long s = 0;
+            for(auto x : v)
+                s += p.value_unchecked(x);
+            return s;
+        });
+}
@@ -0,0 +1,61 @@
+#include "stack_pool.hpp"
+#include "timer.hpp"
+#include "unrolled_stack_pool.hpp"
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+ * Unrolled stacks with K values per node against stack_pool.
+ * The values are pushed round robin on n_stacks stacks, so that
+ * the nodes of a stack are interleaved with the ones of the others,
+ * then every stack is scanned and finally emptied with pop.
+ * The results are in nanoseconds per value.
+ */
+constexpr std::size_t n_stacks = 64;
+constexpr std::size_t n_values = std::size_t(1) << 22;
+constexpr std::size_t rounds = 5;
+
+template <typename Pool>
+void measure(const char* name) {
+    double t_push = 0, t_scan = 0, t_pop = 0;
+    long sum = 0;
+    timer<> t;
+    for(std::size_t r = 0; r < rounds; ++r){
+        Pool pool;
+        std::vector<std::uint32_t> heads(n_stacks, pool.new_stack());
+        t.start();
+        for(std::size_t i = 0; i < n_values; ++i){
+            auto& h = heads[i % n_stacks];
+            h = pool.push(int(i), h);
+        }
+        t_push += t.elapsed();
+        t.start();
+        for(auto h : heads)
+            for(auto x : pool.stack(h))
+                sum += x;
+        t_scan += t.elapsed();
+        t.start();
+        for(auto& h : heads)
+            while(h) h = pool.pop(h);
+        t_pop += t.elapsed();
+    }
+    const double n = rounds * n_values;
+    std::cout << std::setw(12) << name << std::setw(14) << t_push * 1e9 / n
+              << std::setw(14) << t_scan * 1e9 / n << std::setw(14) << t_pop * 1e9 / n
+              << "   (" << sum % 10 << ")" << std::endl;
+}
+
+int main() {
+    std::cout << std::setw(12) << "K" << std::setw(14) << "push [ns]"
+              << std::setw(14) << "scan [ns]" << std::setw(14) << "pop [ns]" << std::endl;
+    measure<stack_pool<int, std::uint32_t>>("stack_pool");
+    measure<unrolled_stack_pool<int, 1, std::uint32_t>>("1");
+    measure<unrolled_stack_pool<int, 2, std::uint32_t>>("2");
+    measure<unrolled_stack_pool<int, 4, std::uint32_t>>("4");
+    measure<unrolled_stack_pool<int, 8, std::uint32_t>>("8");
+    measure<unrolled_stack_pool<int, 16, std::uint32_t>>("16");
+    measure<unrolled_stack_pool<int, 32, std::uint32_t>>("32");
+    measure<unrolled_stack_pool<int, 64, std::uint32_t>>("64");
+}
@@ -0,0 +1,366 @@
+#ifndef CONCURRENT_STACK_POOL_HPP
+#define CONCURRENT_STACK_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "stack_pool.hpp"
+
+/*
+ * A pool of stacks that can be shared by many threads.
+ *
+ * The addressing is the same of stack_pool: the "address" of a node
+ * is 1+idx, and 0 is the end of every stack. Each stack is still
+ * owned by one thread at a time (it can be handed to another thread
+ * through any synchronized channel, e.g. a queue protected by a mutex),
+ * what is shared is the set of free nodes.
+ *
+ * Differently from stack_pool, the capacity is fixed at construction:
+ * a growing std::vector would move the nodes under the feet of the
+ * other threads.
+ *
+ * The free nodes are organized on two levels:
+ *  - every thread owns a thread_cache, a private chain of free nodes
+ *    that is used by push and refilled by pop without any
+ *    synchronization;
+ *  - the pool holds a lock-free stack of batches, i.e. chains of
+ *    batch_size free nodes. A cache that runs dry takes a whole batch
+ *    with a single CAS, a cache that reaches batch_size nodes gives
+ *    them all back as a batch. Nodes that were never used are handed
+ *    out batch_size at a time by an atomic counter.
+ *
+ * A cache cannot be reached by the other threads, so the free nodes it
+ * holds are lost to them: up to batch_size-1 for every thread_cache.
+ * push throws std::bad_alloc only when its own cache is empty, hence a
+ * pool shared by t threads is guaranteed to hold
+ * capacity - (t-1)*(batch_size-1) live nodes.
+ *
+ * The head of the stack of batches is an index tagged with a counter
+ * incremented at every successful CAS, so that a head that has been
+ * popped and pushed back in the meantime (ABA) is not mistaken for
+ * the old one.
+ */
+template <typename T, typename N = std::size_t>
+class concurrent_stack_pool {
+
+    /*
+     * The value is constructed only when the node is pushed and it is
+     * destroyed as soon as the node is popped, so a free node never
+     * holds a T. The anonymous union lets us control its lifetime
+     * while keeping the same shape (value, next) expected by _iterator.
+     */
+    struct node_t {
+        union {
+            T value;
+        };
+        N next;
+        node_t() noexcept {}
+        ~node_t() {}
+    };
+
+    using tagged_type = std::uint64_t; // [ tag : 32 | index : 32 ]
+
+    static tagged_type pack(std::uint32_t idx, std::uint32_t tag) noexcept {
+        return (tagged_type(tag) << 32) | idx;
+    }
+    static std::uint32_t index_of(tagged_type t) noexcept {
+        return static_cast<std::uint32_t>(t);
+    }
+    static std::uint32_t tag_of(tagged_type t) noexcept {
+        return static_cast<std::uint32_t>(t >> 32);
+    }
+
+public:
+    using stack_type = N;
+    using value_type = T;
+    using size_type = std::size_t;
+
+    static constexpr size_type batch_size = 64;
+
+private:
+    size_type cap;
+    std::unique_ptr<node_t[]> pool;
+    // next batch in the shared stack of batches, meaningful only
+    // for the first node of a batch. It is atomic because a thread
+    // may read it while another one is reusing the node.
+    std::unique_ptr<std::atomic<std::uint32_t>[]> batch_next;
+    std::atomic<size_type> used{0};
+    std::atomic<tagged_type> free_batches{pack(0, 0)};
+
+    node_t& node(stack_type x) noexcept {
+        return pool[x - 1];
+    }
+    const node_t& node(stack_type x) const noexcept {
+        return pool[x - 1];
+    }
+
+    void check_logic_error(stack_type x, const char* message) const {
+        if(empty(x))
+            throw std::out_of_range(message);
+    }
+
+    static size_type checked_capacity(size_type n) {
+        if(n > std::numeric_limits<std::uint32_t>::max() ||
+           n > std::numeric_limits<stack_type>::max())
+            throw std::length_error("concurrent_stack_pool capacity too big");
+        return n;
+    }
+
+    stack_type pop_batch() noexcept;
+    void push_batch(stack_type first) noexcept;
+    stack_type fresh_batch() noexcept;
+
+public:
+    /*
+     * The private chain of free nodes of a thread. It must be created
+     * and used by a single thread, and it must be destroyed before
+     * the pool: its destructor gives the remaining nodes back.
+     */
+    class thread_cache {
+        friend class concurrent_stack_pool;
+        concurrent_stack_pool* pool_ptr;
+        stack_type head{0};
+        size_type count{0};
+
+        stack_type take();
+        void give(stack_type x) noexcept;
+
+    public:
+        explicit thread_cache(concurrent_stack_pool& p) noexcept
+            : pool_ptr{&p} {};
+        thread_cache(const thread_cache&) = delete;
+        thread_cache& operator=(const thread_cache&) = delete;
+        ~thread_cache() {
+            if(head)
+                pool_ptr->push_batch(head);
+        }
+    };
+
+    /*
+     * The capacity cannot change after construction. It must fit both
+     * in N and in the 32 bits of index of the tagged head, otherwise
+     * std::length_error is thrown before anything is allocated.
+     */
+    explicit concurrent_stack_pool(size_type n)
+        : cap{checked_capacity(n)}, pool{new node_t[cap]},
+          batch_next{new std::atomic<std::uint32_t>[cap]} {}
+
+    concurrent_stack_pool(const concurrent_stack_pool&) = delete;
+    concurrent_stack_pool& operator=(const concurrent_stack_pool&) = delete;
+
+    ~concurrent_stack_pool();
+
+    stack_type new_stack() const noexcept {
+        return end();
+    }
+
+    size_type capacity() const noexcept {
+        return cap;
+    }
+
+    bool empty(stack_type x) const noexcept {
+        return x == end();
+    }
+
+    stack_type end() const noexcept {
+        return stack_type(0);
+    }
+
+    T& value(stack_type x) {
+        check_logic_error(x, "Requested value on empty stack");
+        return node(x).value;
+    }
+    const T& value(stack_type x) const {
+        check_logic_error(x, "Requested value on empty stack");
+        return node(x).value;
+    }
+
+    stack_type& next(stack_type x) {
+        check_logic_error(x, "Requested next on empty stack");
+        return node(x).next;
+    }
+    const stack_type& next(stack_type x) const {
+        check_logic_error(x, "Requested next on empty stack");
+        return node(x).next;
+    }
+
+    stack_type push(const T& val, stack_type head, thread_cache& c) {
+        return _push(c, head, val);
+    }
+    stack_type push(T&& val, stack_type head, thread_cache& c) {
+        return _push(c, head, std::move(val));
+    }
+
+    stack_type pop(stack_type x, thread_cache& c);
+
+    stack_type free_stack(stack_type x, thread_cache& c) noexcept {
+        while(x) x = pop(x, c);
+        return x;
+    }
+
+    using iterator = _iterator<node_t*, T, N>;
+    using const_iterator = _iterator<const node_t*, const T, N>;
+
+    iterator begin(stack_type x) noexcept {
+        return iterator{x, pool.get()};
+    }
+    iterator end(stack_type ) noexcept {
+        return iterator{0, pool.get()};
+    }
+    const_iterator begin(stack_type x) const noexcept {
+        return const_iterator{x, pool.get()};
+    }
+    const_iterator end(stack_type ) const noexcept {
+        return const_iterator{0, pool.get()};
+    }
+    const_iterator cbegin(stack_type x) const noexcept {
+        return const_iterator{x, pool.get()};
+    }
+    const_iterator cend(stack_type ) const noexcept {
+        return const_iterator{0, pool.get()};
+    }
+
+private:
+    template <typename... Args>
+    stack_type _push(thread_cache& c, stack_type head, Args&&... args);
+};
+
+/*
+ * Takes the first batch of the shared stack of batches, or returns 0
+ * if there are none. Reading batch_next of a head that has just been
+ * taken by another thread gives a meaningless value, but then the tag
+ * has changed and the CAS fails.
+ */
+template <typename T, typename N>
+N concurrent_stack_pool<T, N>::pop_batch() noexcept {
+    tagged_type old = free_batches.load(std::memory_order_acquire);
+    while(index_of(old)){
+        auto rest = batch_next[index_of(old) - 1].load(std::memory_order_relaxed);
+        if(free_batches.compare_exchange_weak(old, pack(rest, tag_of(old) + 1),
+                                              std::memory_order_acquire,
+                                              std::memory_order_acquire))
+            return static_cast<stack_type>(index_of(old));
+    }
+    return end();
+};
+
+template <typename T, typename N>
+void concurrent_stack_pool<T, N>::push_batch(N first) noexcept {
+    tagged_type old = free_batches.load(std::memory_order_relaxed);
+    do {
+        batch_next[first - 1].store(index_of(old), std::memory_order_relaxed);
+    } while(!free_batches.compare_exchange_weak(
+                old, pack(static_cast<std::uint32_t>(first), tag_of(old) + 1),
+                std::memory_order_release, std::memory_order_relaxed));
+};
+
+/*
+ * Links up to batch_size nodes that were never used.
+ * Returns 0 when the pool is exhausted.
+ */
+template <typename T, typename N>
+N concurrent_stack_pool<T, N>::fresh_batch() noexcept {
+    if(used.load(std::memory_order_relaxed) >= cap)
+        return end();
+    size_type first = used.fetch_add(batch_size, std::memory_order_relaxed);
+    if(first >= cap)
+        return end();
+    size_type last = std::min(first + batch_size, cap);
+    for(size_type i = first; i + 1 < last; ++i)
+        pool[i].next = static_cast<stack_type>(i + 2);
+    pool[last - 1].next = end();
+    return static_cast<stack_type>(first + 1);
+};
+
+/*
+ * A cache that runs dry first tries to reuse a batch given back
+ * by some thread, then it carves a new one from the unused nodes.
+ * It throws std::bad_alloc if the pool is exhausted.
+ */
+template <typename T, typename N>
+N concurrent_stack_pool<T, N>::thread_cache::take() {
+    if(!head){
+        head = pool_ptr->pop_batch();
+        if(!head)
+            head = pool_ptr->fresh_batch();
+        if(!head)
+            throw std::bad_alloc{};
+        count = 0;
+        for(auto x = head; x; x = pool_ptr->node(x).next)
+            ++count;
+    }
+    auto tmp = head;
+    head = pool_ptr->node(head).next;
+    --count;
+    return tmp;
+};
+
+/*
+ * When the cache holds a whole batch, it is given back so that the
+ * free nodes do not pile up on a single thread: a cache never keeps
+ * more than batch_size-1 nodes away from the others.
+ */
+template <typename T, typename N>
+void concurrent_stack_pool<T, N>::thread_cache::give(N x) noexcept {
+    pool_ptr->node(x).next = head;
+    head = x;
+    if(++count < batch_size)
+        return;
+    pool_ptr->push_batch(head);
+    head = pool_ptr->end();
+    count = 0;
+};
+
+/*
+ * If the construction of T throws, the node goes back to the cache.
+ */
+template <typename T, typename N>
+template <typename... Args>
+N concurrent_stack_pool<T, N>::_push(thread_cache& c, N head, Args&&... args) {
+    auto x = c.take();
+    try {
+        ::new (static_cast<void*>(&node(x).value)) T(std::forward<Args>(args)...);
+    } catch(...) {
+        c.give(x);
+        throw;
+    }
+    node(x).next = head;
+    return x;
+};
+
+template <typename T, typename N>
+N concurrent_stack_pool<T, N>::pop(N x, thread_cache& c) {
+    N tmp = next(x); // internally checks for logic error
+    node(x).value.~T();
+    c.give(x);
+    return tmp;
+};
+
+/*
+ * All the thread_caches are gone, so every free node belongs to
+ * a batch of the shared stack: the remaining nodes are live and
+ * their values must be destroyed.
+ */
+template <typename T, typename N>
+concurrent_stack_pool<T, N>::~concurrent_stack_pool() {
+    if constexpr(!std::is_trivially_destructible<T>::value){
+        size_type n = std::min(used.load(), cap);
+        std::vector<bool> is_free(n, false);
+        for(auto b = index_of(free_batches.load()); b; b = batch_next[b - 1].load())
+            for(stack_type x = static_cast<stack_type>(b); x; x = node(x).next)
+                is_free[x - 1] = true;
+        for(size_type i = 0; i < n; ++i)
+            if(!is_free[i])
+                pool[i].value.~T();
+    }
+};
+
+#endif // CONCURRENT_STACK_POOL_HPP
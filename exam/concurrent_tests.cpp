@@ -0,0 +1,118 @@
+#include "catch.hpp"
+
+#include "concurrent_stack_pool.hpp"
+#include <memory>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+SCENARIO("a concurrent pool behaves like a stack_pool on a single thread"){
+  concurrent_stack_pool<int, std::uint32_t> pool{256};
+  concurrent_stack_pool<int, std::uint32_t>::thread_cache cache{pool};
+
+  auto l = pool.new_stack();
+  REQUIRE(pool.empty(l));
+
+  l = pool.push(1, l, cache);
+  l = pool.push(2, l, cache);
+  l = pool.push(3, l, cache);
+  REQUIRE(pool.value(l) == 3);
+  REQUIRE(std::accumulate(pool.begin(l), pool.end(l), 0) == 6);
+
+  l = pool.pop(l, cache);
+  REQUIRE(pool.value(l) == 2);
+
+  l = pool.free_stack(l, cache);
+  REQUIRE(pool.empty(l));
+  REQUIRE_THROWS_AS(pool.pop(l, cache), std::out_of_range);
+}
+
+SCENARIO("freed nodes are reused and the capacity is never exceeded"){
+  concurrent_stack_pool<std::unique_ptr<int>, std::uint16_t> pool{128};
+  concurrent_stack_pool<std::unique_ptr<int>, std::uint16_t>::thread_cache cache{pool};
+
+  auto l = pool.new_stack();
+  for(int round = 0; round < 10; ++round){
+    for(int i = 0; i < 128; ++i)
+      l = pool.push(std::make_unique<int>(i), l, cache);
+    REQUIRE(*pool.value(l) == 127);
+    l = pool.free_stack(l, cache);
+  }
+
+  for(int i = 0; i < 128; ++i)
+    l = pool.push(std::make_unique<int>(i), l, cache);
+  REQUIRE_THROWS_AS(pool.push(std::make_unique<int>(0), l, cache), std::bad_alloc);
+  // the remaining values are released by the pool
+}
+
+SCENARIO("a capacity that does not fit the indices is refused"){
+  using narrow_pool = concurrent_stack_pool<int, std::uint16_t>;
+  REQUIRE_THROWS_AS(narrow_pool{std::size_t(1) << 16}, std::length_error);
+  using wide_pool = concurrent_stack_pool<int, std::uint64_t>;
+  REQUIRE_THROWS_AS(wide_pool{std::size_t(1) << 40}, std::length_error);
+}
+
+SCENARIO("a cache does not keep a whole batch of free nodes"){
+  using pool_type = concurrent_stack_pool<int, std::uint32_t>;
+  pool_type pool{256};
+  pool_type::thread_cache a{pool};
+  pool_type::thread_cache b{pool};
+
+  auto la = pool.new_stack();
+  for(int i = 0; i < 100; ++i)
+    la = pool.push(i, la, a);
+  la = pool.free_stack(la, a);
+
+  THEN("another cache can take the nodes freed by the first one"){
+    auto lb = pool.new_stack();
+    for(int i = 0; i < 256 - int(pool_type::batch_size - 1); ++i)
+      lb = pool.push(i, lb, b);
+    REQUIRE(std::distance(pool.begin(lb), pool.end(lb)) == 256 - int(pool_type::batch_size - 1));
+    lb = pool.free_stack(lb, b);
+  }
+}
+
+SCENARIO("many threads push and pop on their own stacks"){
+  constexpr int n_threads = 4;
+  constexpr int n_stacks = 8;
+  constexpr int depth = 100;
+  using pool_type = concurrent_stack_pool<int, std::uint32_t>;
+  // the free nodes held by the caches of the other threads
+  constexpr auto headroom = (n_threads - 1) * (pool_type::batch_size - 1);
+  pool_type pool{n_threads * n_stacks * depth + headroom};
+  std::vector<int> errors(n_threads, 0);
+
+  std::vector<std::thread> workers;
+  for(int t = 0; t < n_threads; ++t)
+    workers.emplace_back([&pool, &errors, t]{
+      pool_type::thread_cache cache{pool};
+      std::vector<std::uint32_t> heads(n_stacks, pool.new_stack());
+      try {
+        for(int round = 0; round < 20; ++round){
+          for(auto& h : heads)
+            for(int i = 0; i < depth; ++i)
+              h = pool.push(t * depth + i, h, cache);
+          for(auto& h : heads){
+            for(int i = depth - 1; i >= 0; --i){
+              if(pool.value(h) != t * depth + i)
+                ++errors[t];
+              h = pool.pop(h, cache);
+            }
+            if(!pool.empty(h))
+              ++errors[t];
+          }
+        }
+      } catch(const std::bad_alloc&) {
+        // an exception escaping the thread would terminate the test
+        ++errors[t];
+        for(auto& h : heads)
+          h = pool.free_stack(h, cache);
+      }
+    });
+  for(auto& w : workers)
+    w.join();
+
+  REQUIRE(std::accumulate(errors.begin(), errors.end(), 0) == 0);
+}
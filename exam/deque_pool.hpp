@@ -0,0 +1,320 @@
+#ifndef DEQUE_POOL_HPP
+#define DEQUE_POOL_HPP
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "stack_pool.hpp"
+
+/*
+ * A node of a deque_pool: a value and the addresses of the nodes
+ * before (prev) and after (next) it. The free nodes are chained
+ * through next, as in stack_pool.
+ */
+template <typename T, typename N>
+struct deque_node : value_slot<T> {
+    N next;
+    N prev;
+    template <typename... Args>
+        deque_node(N n, N p, Args&&... args)
+        : value_slot<T>{std::in_place, std::forward<Args>(args)...}, next{n}, prev{p} {};
+};
+
+/*
+ * A view of the nodes in which next is prev, so that _iterator
+ * walks a deque backwards.
+ */
+template <typename V, typename M>
+struct reversed_node_ref {
+    V& value;
+    M& next;
+};
+
+template <typename nodes_t>
+struct reversed_view {
+    nodes_t nodes;
+    auto operator[](std::size_t i) const noexcept {
+        auto&& n = nodes[i];
+        using V = std::remove_reference_t<decltype((n.value))>;
+        using M = std::remove_reference_t<decltype((n.prev))>;
+        return reversed_node_ref<V, M>{n.value, n.prev};
+    }
+};
+
+/*
+ * A deque of a deque_pool: the addresses of its first and last node.
+ */
+template <typename N>
+struct deque_handle {
+    N front{0};
+    N back{0};
+};
+
+/*
+ * A pool of double-ended queues, sibling of stack_pool and queue_pool.
+ *
+ * The nodes are doubly linked, so a deque can grow and shrink at both
+ * ends in O(1) and be walked in both directions. As in stack_pool, an
+ * address is the index of a node plus one, 0 is the end of every deque,
+ * the nodes come from the free nodes when there are any and are given
+ * back to them when popped.
+ */
+template <typename T, typename N = std::size_t, typename Storage = vector_storage>
+class deque_pool {
+    using node_type = deque_node<T, N>;
+    using container_type = typename Storage::template container<node_type>;
+    using nodes_view = decltype(storage_view(std::declval<container_type&>()));
+    using const_nodes_view = decltype(storage_view(std::declval<const container_type&>()));
+
+    container_type pool;
+    N free_nodes{0};
+
+    node_type& node(N x) noexcept {
+        return pool[x - 1];
+    }
+    const node_type& node(N x) const noexcept {
+        return pool[x - 1];
+    }
+
+    void check_logic_error(N x, const char* message) const {
+        if(empty(x))
+            throw std::out_of_range(message);
+    }
+
+    /*
+     * Takes a node, free or new, with the given links;
+     * see stack_pool::_push for the exception safety.
+     */
+    template <typename... Args>
+    N take(N next, N prev, Args&&... args);
+
+    /*
+     * Destroys the value of x and gives the node back.
+     */
+    void give(N x) noexcept {
+        node(x).destroy();
+        node(x).next = free_nodes;
+        free_nodes = x;
+    }
+
+    /*
+     * See stack_pool::_stack
+     */
+    template <typename P>
+    class _deque {
+        P* pool_ptr;
+        deque_handle<N> d;
+    public:
+        _deque(P* ptr, const deque_handle<N>& x) noexcept
+            : pool_ptr{ptr}, d{x} {};
+        auto begin() const noexcept {
+            return pool_ptr->begin(d);
+        }
+        auto end() const noexcept {
+            return pool_ptr->end(d);
+        }
+    };
+
+public:
+    using stack_type = N;
+    using deque_type = deque_handle<N>;
+    using value_type = T;
+    using size_type = typename container_type::size_type;
+    using iterator = _iterator<nodes_view, T, N>;
+    using const_iterator = _iterator<const_nodes_view, const T, N>;
+    using reverse_iterator = _iterator<reversed_view<nodes_view>, T, N>;
+    using const_reverse_iterator = _iterator<reversed_view<const_nodes_view>, const T, N>;
+
+    deque_pool() = default;
+
+    explicit deque_pool(size_type n) {
+        reserve(n);
+    }
+
+    void reserve(size_type n) {
+        pool.reserve(n);
+    }
+
+    size_type capacity() const noexcept {
+        return pool.capacity();
+    }
+
+    deque_type new_deque() const noexcept {
+        return {};
+    }
+
+    N end() const noexcept {
+        return N(0);
+    }
+
+    bool empty(N x) const noexcept {
+        return x == end();
+    }
+    bool empty(const deque_type& d) const noexcept {
+        return empty(d.front);
+    }
+
+    T& front(const deque_type& d) {
+        check_logic_error(d.front, "Requested front on empty deque");
+        return node(d.front).value;
+    }
+    const T& front(const deque_type& d) const {
+        check_logic_error(d.front, "Requested front on empty deque");
+        return node(d.front).value;
+    }
+
+    T& back(const deque_type& d) {
+        check_logic_error(d.back, "Requested back on empty deque");
+        return node(d.back).value;
+    }
+    const T& back(const deque_type& d) const {
+        check_logic_error(d.back, "Requested back on empty deque");
+        return node(d.back).value;
+    }
+
+    /*
+     * Each function returns the new deque, as stack_pool::push
+     * returns the new head.
+     */
+    deque_type push_front(const T& val, const deque_type& d) {
+        return emplace_front(d, val);
+    }
+    deque_type push_front(T&& val, const deque_type& d) {
+        return emplace_front(d, std::move(val));
+    }
+    deque_type push_back(const T& val, const deque_type& d) {
+        return emplace_back(d, val);
+    }
+    deque_type push_back(T&& val, const deque_type& d) {
+        return emplace_back(d, std::move(val));
+    }
+
+    template <typename... Args>
+    deque_type emplace_front(const deque_type& d, Args&&... args) {
+        auto x = take(d.front, end(), std::forward<Args>(args)...);
+        if(empty(d))
+            return {x, x};
+        node(d.front).prev = x;
+        return {x, d.back};
+    }
+
+    template <typename... Args>
+    deque_type emplace_back(const deque_type& d, Args&&... args) {
+        auto x = take(end(), d.back, std::forward<Args>(args)...);
+        if(empty(d))
+            return {x, x};
+        node(d.back).next = x;
+        return {d.front, x};
+    }
+
+    /*
+     * They throw std::out_of_range if the deque is empty.
+     */
+    deque_type pop_front(const deque_type& d) {
+        check_logic_error(d.front, "Requested pop_front on empty deque");
+        auto x = node(d.front).next;
+        give(d.front);
+        if(empty(x))
+            return {};
+        node(x).prev = end();
+        return {x, d.back};
+    }
+
+    deque_type pop_back(const deque_type& d) {
+        check_logic_error(d.back, "Requested pop_back on empty deque");
+        auto x = node(d.back).prev;
+        give(d.back);
+        if(empty(x))
+            return {};
+        node(x).next = end();
+        return {d.front, x};
+    }
+
+    /*
+     * All the nodes go back to the free nodes with a single relink,
+     * in O(1) if T is trivially destructible.
+     */
+    deque_type free_deque(const deque_type& d) noexcept;
+
+    iterator begin(const deque_type& d) noexcept {
+        return iterator{d.front, storage_view(pool)};
+    }
+    iterator end(const deque_type&) noexcept {
+        return iterator{0, storage_view(pool)};
+    }
+
+    const_iterator begin(const deque_type& d) const noexcept {
+        return const_iterator{d.front, storage_view(pool)};
+    }
+    const_iterator end(const deque_type&) const noexcept {
+        return const_iterator{0, storage_view(pool)};
+    }
+
+    const_iterator cbegin(const deque_type& d) const noexcept {
+        return begin(d);
+    }
+    const_iterator cend(const deque_type& d) const noexcept {
+        return end(d);
+    }
+
+    /*
+     * From the back to the front.
+     */
+    reverse_iterator rbegin(const deque_type& d) noexcept {
+        return reverse_iterator{d.back, {storage_view(pool)}};
+    }
+    reverse_iterator rend(const deque_type&) noexcept {
+        return reverse_iterator{0, {storage_view(pool)}};
+    }
+
+    const_reverse_iterator rbegin(const deque_type& d) const noexcept {
+        return const_reverse_iterator{d.back, {storage_view(pool)}};
+    }
+    const_reverse_iterator rend(const deque_type&) const noexcept {
+        return const_reverse_iterator{0, {storage_view(pool)}};
+    }
+
+    auto deque(const deque_type& d) noexcept {
+        return _deque<deque_pool>{this, d};
+    }
+    auto deque(const deque_type& d) const noexcept {
+        return _deque<const deque_pool>{this, d};
+    }
+};
+
+template <typename T, typename N, typename S>
+template <typename... Args>
+N deque_pool<T, N, S>::take(N next, N prev, Args&&... args) {
+    if(empty(free_nodes)){
+        if constexpr(sizeof(N) < sizeof(size_type)){
+            if(pool.size() >= std::numeric_limits<N>::max())
+                throw std::length_error("deque_pool: too many nodes for the index type N");
+        }
+        pool.emplace_back(next, prev, std::forward<Args>(args)...);
+        return static_cast<N>(pool.size());
+    }
+    auto x = free_nodes;
+    node(x).construct(std::forward<Args>(args)...);
+    free_nodes = node(x).next;
+    node(x).next = next;
+    node(x).prev = prev;
+    return x;
+};
+
+template <typename T, typename N, typename S>
+auto deque_pool<T, N, S>::free_deque(const deque_type& d) noexcept -> deque_type {
+    if(empty(d))
+        return {};
+    if constexpr(!std::is_trivially_destructible<T>::value){
+        for(auto x = d.front; x; x = node(x).next)
+            node(x).destroy();
+    }
+    node(d.back).next = free_nodes;
+    free_nodes = d.front;
+    return {};
+};
+
+#endif // DEQUE_POOL_HPP
@@ -0,0 +1,117 @@
+#include "catch.hpp"
+
+#include "deque_pool.hpp"
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+SCENARIO("double-ended queues in a pool"){
+  GIVEN("a deque filled at both ends"){
+    deque_pool<int, std::uint16_t> pool;
+    auto d = pool.new_deque();
+    REQUIRE(pool.empty(d));
+    for(int i = 1; i <= 3; ++i){
+      d = pool.push_back(i, d);
+      d = pool.push_front(-i, d);
+    }
+
+    THEN("it can be walked in both directions"){
+      REQUIRE(pool.front(d) == -3);
+      REQUIRE(pool.back(d) == 3);
+      std::vector<int> v(pool.begin(d), pool.end(d));
+      REQUIRE(v == std::vector<int>{-3, -2, -1, 1, 2, 3});
+      std::vector<int> r(pool.rbegin(d), pool.rend(d));
+      REQUIRE(r == std::vector<int>{3, 2, 1, -1, -2, -3});
+      int sum = 0;
+      for(auto x : pool.deque(d))
+        sum += x;
+      REQUIRE(sum == 0);
+    }
+
+    WHEN("it is popped at both ends"){
+      d = pool.pop_front(d);
+      d = pool.pop_back(d);
+
+      THEN("the links stay consistent"){
+        REQUIRE(pool.front(d) == -2);
+        REQUIRE(pool.back(d) == 2);
+        std::vector<int> v(pool.cbegin(d), pool.cend(d));
+        REQUIRE(v == std::vector<int>{-2, -1, 1, 2});
+        const auto& cpool = pool;
+        std::vector<int> r(cpool.rbegin(d), cpool.rend(d));
+        REQUIRE(r == std::vector<int>{2, 1, -1, -2});
+      }
+
+      THEN("the freed nodes are reused"){
+        d = pool.push_front(10, d);
+        d = pool.push_back(20, d);
+        REQUIRE(pool.capacity() >= 6);
+        REQUIRE(std::accumulate(pool.begin(d), pool.end(d), 0) == 30);
+      }
+    }
+
+    WHEN("it is emptied from the back"){
+      while(!pool.empty(d))
+        d = pool.pop_back(d);
+
+      THEN("both ends are gone"){
+        REQUIRE(pool.begin(d) == pool.end(d));
+        REQUIRE(pool.rbegin(d) == pool.rend(d));
+        REQUIRE_THROWS_AS(pool.pop_front(d), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.pop_back(d), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.back(d), std::out_of_range);
+      }
+    }
+
+    WHEN("it is freed"){
+      d = pool.free_deque(d);
+      auto e = pool.new_deque();
+      for(int i = 0; i < 6; ++i)
+        e = pool.push_front(i, e);
+
+      THEN("a new deque takes all its nodes"){
+        REQUIRE(pool.empty(d));
+        REQUIRE(pool.capacity() < 12);
+        REQUIRE(pool.back(e) == 0);
+        REQUIRE(pool.front(e) == 5);
+      }
+    }
+  }
+
+  GIVEN("a deque of strings"){
+    deque_pool<std::string> pool;
+    auto d = pool.new_deque();
+    d = pool.emplace_back(d, 2, 'b');
+    d = pool.emplace_front(d, 1, 'a');
+    d = pool.push_back(std::string{"c"}, d);
+
+    THEN("they are constructed in place and destroyed when popped"){
+      std::string s;
+      for(auto& x : pool.deque(d))
+        s += x;
+      REQUIRE(s == "abbc");
+      d = pool.pop_back(d);
+      REQUIRE(pool.back(d) == "bb");
+      d = pool.push_back("d", d);
+      REQUIRE(pool.back(d) == "d");
+      d = pool.free_deque(d);
+      REQUIRE(pool.empty(d));
+    }
+  }
+
+  GIVEN("a deque of move-only values"){
+    deque_pool<std::unique_ptr<int>> pool;
+    auto d = pool.push_back(std::make_unique<int>(1), pool.new_deque());
+    d = pool.push_front(std::make_unique<int>(0), d);
+
+    THEN("front and back own them"){
+      REQUIRE(*pool.front(d) == 0);
+      REQUIRE(*pool.back(d) == 1);
+      d = pool.pop_front(d);
+      REQUIRE(pool.front(d) == pool.back(d));
+    }
+  }
+}
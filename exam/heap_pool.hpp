@@ -0,0 +1,293 @@
+#ifndef HEAP_POOL_HPP
+#define HEAP_POOL_HPP
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "stack_pool.hpp"
+
+/*
+ * A node of a heap_pool: a value, its first child and its next
+ * sibling. The free nodes are chained through next, as in stack_pool.
+ */
+template <typename T, typename N>
+struct heap_node : value_slot<T> {
+    N child;
+    N next;
+    template <typename... Args>
+        heap_node(N c, N n, Args&&... args)
+        : value_slot<T>{std::in_place, std::forward<Args>(args)...}, child{c}, next{n} {};
+};
+
+/*
+ * A pool of priority queues, kept as pairing heaps in one container of
+ * nodes, sibling of stack_pool.
+ *
+ * A heap is the address of its root (end() if it is empty); the
+ * children of a node are a singly linked list through next. As for
+ * std::priority_queue, top is the largest value according to Cmp
+ * (std::less gives a max-heap).
+ *
+ * push and meld are O(1): they just link two roots. pop is O(log n)
+ * amortized (two-pass pairing of the children of the root). The nodes
+ * come from the free nodes when there are any and go back to them
+ * when popped, so many small heaps share the same memory.
+ */
+template <typename T, typename Cmp = std::less<T>, typename N = std::size_t,
+          typename Storage = vector_storage>
+class heap_pool {
+    using node_type = heap_node<T, N>;
+    using container_type = typename Storage::template container<node_type>;
+
+    container_type pool;
+    N free_nodes{0};
+    Cmp compare;
+
+    node_type& node(N x) noexcept {
+        return pool[x - 1];
+    }
+    const node_type& node(N x) const noexcept {
+        return pool[x - 1];
+    }
+
+    void check_logic_error(N x, const char* message) const {
+        if(empty(x))
+            throw std::out_of_range(message);
+    }
+
+    /*
+     * Takes a node, free or new, with no child and no sibling;
+     * see stack_pool::_push for the exception safety.
+     */
+    template <typename... Args>
+    N take(Args&&... args);
+
+    /*
+     * Makes the root that loses the comparison the first child of
+     * the other one, which is returned. Both must have no sibling.
+     */
+    N link(N a, N b) {
+        if(compare(node(a).value, node(b).value))
+            std::swap(a, b);
+        node(b).next = node(a).child;
+        node(a).child = b;
+        return a;
+    }
+
+public:
+    using heap_type = N;
+    using value_type = T;
+    using value_compare = Cmp;
+    using size_type = typename container_type::size_type;
+
+    heap_pool() = default;
+
+    explicit heap_pool(const Cmp& cmp) : compare{cmp} {}
+
+    explicit heap_pool(size_type n, const Cmp& cmp = Cmp{}) : compare{cmp} {
+        reserve(n);
+    }
+
+    void reserve(size_type n) {
+        pool.reserve(n);
+    }
+
+    size_type capacity() const noexcept {
+        return pool.capacity();
+    }
+
+    heap_type new_heap() const noexcept {
+        return end();
+    }
+
+    heap_type end() const noexcept {
+        return heap_type(0);
+    }
+
+    bool empty(heap_type x) const noexcept {
+        return x == end();
+    }
+
+    value_compare value_comp() const {
+        return compare;
+    }
+
+    /*
+     * The largest value of the heap x.
+     */
+    const T& top(heap_type x) const {
+        check_logic_error(x, "Requested top on empty heap");
+        return node(x).value;
+    }
+
+    /*
+     * Each function returns the new root, as stack_pool::push
+     * returns the new head.
+     */
+    heap_type push(const T& val, heap_type x) {
+        return emplace(x, val);
+    }
+    heap_type push(T&& val, heap_type x) {
+        return emplace(x, std::move(val));
+    }
+
+    /*
+     * If Cmp throws, the new value is destroyed and x is left as it was.
+     */
+    template <typename... Args>
+    heap_type emplace(heap_type x, Args&&... args);
+
+    /*
+     * The heap with the values of both a and b, which must be two
+     * different heaps of this pool; they are not to be used anymore.
+     */
+    heap_type meld(heap_type a, heap_type b) {
+        if(empty(a))
+            return b;
+        if(empty(b))
+            return a;
+        return link(a, b);
+    }
+
+    /*
+     * It throws std::out_of_range if x is empty. If Cmp throws, x
+     * still holds all its values and is still a valid heap, with
+     * another shape.
+     */
+    heap_type pop(heap_type x);
+
+    /*
+     * All the nodes go back to the free nodes, in O(n).
+     */
+    heap_type free_heap(heap_type x) noexcept;
+};
+
+template <typename T, typename C, typename N, typename S>
+template <typename... Args>
+N heap_pool<T, C, N, S>::take(Args&&... args) {
+    if(empty(free_nodes)){
+        if constexpr(sizeof(N) < sizeof(size_type)){
+            if(pool.size() >= std::numeric_limits<N>::max())
+                throw std::length_error("heap_pool: too many nodes for the index type N");
+        }
+        pool.emplace_back(end(), end(), std::forward<Args>(args)...);
+        return static_cast<N>(pool.size());
+    }
+    auto x = free_nodes;
+    node(x).construct(std::forward<Args>(args)...);
+    free_nodes = node(x).next;
+    node(x).child = end();
+    node(x).next = end();
+    return x;
+};
+
+template <typename T, typename C, typename N, typename S>
+template <typename... Args>
+N heap_pool<T, C, N, S>::emplace(N x, Args&&... args) {
+    auto y = take(std::forward<Args>(args)...);
+    try {
+        return meld(x, y);
+    } catch(...) {
+        node(y).destroy();
+        node(y).next = free_nodes;
+        free_nodes = y;
+        throw;
+    }
+};
+
+/*
+ * The children of the root are linked in pairs from left to right,
+ * collecting the winners in a list (in reverse order), then the list
+ * is linked into a single root from right to left.
+ * The root is freed only at the end: if Cmp throws, every piece built
+ * so far is a heap of values not greater than the one of the root, so
+ * they all go back to be its children.
+ */
+template <typename T, typename C, typename N, typename S>
+N heap_pool<T, C, N, S>::pop(N x) {
+    check_logic_error(x, "Requested pop on empty heap");
+    N c = node(x).child;
+    N pairs = end();
+    N root = end();
+    N a = end(), b = end(); // the roots being linked, out of any list
+    try {
+        while(c){
+            a = c;
+            b = node(a).next;
+            if(empty(b)){
+                node(a).next = pairs;
+                pairs = a;
+                a = end();
+                break;
+            }
+            c = node(b).next;
+            node(a).next = node(b).next = end();
+            auto w = link(a, b);
+            a = b = end();
+            node(w).next = pairs;
+            pairs = w;
+        }
+
+        while(pairs){
+            a = pairs;
+            pairs = node(a).next;
+            node(a).next = end();
+            root = meld(root, a);
+            a = end();
+        }
+    } catch(...) {
+        N children = c;
+        for(auto y : {a, b, root}){
+            if(y){
+                node(y).next = children;
+                children = y;
+            }
+        }
+        while(pairs){
+            auto p = pairs;
+            pairs = node(p).next;
+            node(p).next = children;
+            children = p;
+        }
+        node(x).child = children;
+        throw;
+    }
+
+    node(x).destroy();
+    node(x).next = free_nodes;
+    free_nodes = x;
+    return root;
+};
+
+/*
+ * The tree is flattened in place into a single list through next:
+ * the children of every node are spliced right after it, walking
+ * each list of children once to find its tail.
+ */
+template <typename T, typename C, typename N, typename S>
+N heap_pool<T, C, N, S>::free_heap(N x) noexcept {
+    if(empty(x))
+        return x;
+    auto last = x;
+    for(auto y = x; y; y = node(y).next){
+        if(node(y).child){
+            auto tail = node(y).child;
+            while(node(tail).next)
+                tail = node(tail).next;
+            node(tail).next = node(y).next;
+            node(y).next = node(y).child;
+            node(y).child = end();
+        }
+        node(y).destroy();
+        last = y;
+    }
+    node(last).next = free_nodes;
+    free_nodes = x;
+    return end();
+};
+
+#endif // HEAP_POOL_HPP
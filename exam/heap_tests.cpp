@@ -0,0 +1,205 @@
+#include "catch.hpp"
+
+#include "heap_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+SCENARIO("priority queues as pairing heaps in a pool"){
+  GIVEN("a heap with some values"){
+    heap_pool<int, std::less<int>, std::uint16_t> pool;
+    auto h = pool.new_heap();
+    REQUIRE(pool.empty(h));
+    for(int x : {5, 1, 8, 3, 9, 2, 7})
+      h = pool.push(x, h);
+
+    THEN("top is the largest value"){
+      REQUIRE(pool.top(h) == 9);
+      REQUIRE(pool.capacity() >= 7);
+    }
+
+    WHEN("it is popped to the end"){
+      std::vector<int> v;
+      while(!pool.empty(h)){
+        v.push_back(pool.top(h));
+        h = pool.pop(h);
+      }
+
+      THEN("the values come out sorted"){
+        REQUIRE(v == std::vector<int>{9, 8, 7, 5, 3, 2, 1});
+        REQUIRE_THROWS_AS(pool.pop(h), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.top(h), std::out_of_range);
+      }
+
+      THEN("the nodes are reused"){
+        for(int i = 0; i < 7; ++i)
+          h = pool.push(i, h);
+        REQUIRE(pool.capacity() < 14);
+        REQUIRE(pool.top(h) == 6);
+      }
+    }
+
+    WHEN("it is melded with another heap"){
+      auto g = pool.new_heap();
+      for(int x : {4, 10, 6})
+        g = pool.push(x, g);
+      h = pool.meld(h, g);
+
+      THEN("the result has the values of both"){
+        std::vector<int> v;
+        for(; !pool.empty(h); h = pool.pop(h))
+          v.push_back(pool.top(h));
+        REQUIRE(v == std::vector<int>{10, 9, 8, 7, 6, 5, 4, 3, 2, 1});
+      }
+    }
+
+    WHEN("it is freed"){
+      h = pool.pop(h);
+      h = pool.free_heap(h);
+      auto g = pool.new_heap();
+      for(int i = 0; i < 7; ++i)
+        g = pool.push(i, g);
+
+      THEN("a new heap takes all its nodes"){
+        REQUIRE(pool.empty(h));
+        REQUIRE(pool.capacity() < 14);
+        REQUIRE(pool.top(g) == 6);
+      }
+    }
+  }
+
+  GIVEN("many heaps with random values and a min-heap comparison"){
+    heap_pool<int, std::greater<int>> pool;
+    std::vector<heap_pool<int, std::greater<int>>::heap_type> heaps(8, pool.new_heap());
+    std::vector<std::vector<int>> expected(8);
+    std::mt19937 gen{42};
+    std::uniform_int_distribution<int> dist{0, 1000};
+    for(int i = 0; i < 2000; ++i){
+      auto k = i % 8;
+      auto x = dist(gen);
+      heaps[k] = pool.push(x, heaps[k]);
+      expected[k].push_back(x);
+      if(i % 3 == 0){
+        auto m = std::min_element(expected[k].begin(), expected[k].end());
+        REQUIRE(pool.top(heaps[k]) == *m);
+        expected[k].erase(m);
+        heaps[k] = pool.pop(heaps[k]);
+      }
+    }
+
+    THEN("every heap pops its own values in order"){
+      for(std::size_t k = 0; k < 8; ++k){
+        std::sort(expected[k].begin(), expected[k].end());
+        std::vector<int> v;
+        for(; !pool.empty(heaps[k]); heaps[k] = pool.pop(heaps[k]))
+          v.push_back(pool.top(heaps[k]));
+        REQUIRE(v == expected[k]);
+      }
+    }
+  }
+
+  GIVEN("a heap of strings"){
+    heap_pool<std::string> pool;
+    auto h = pool.emplace(pool.new_heap(), 3, 'b');
+    h = pool.push("c", h);
+    h = pool.emplace(h, "a");
+
+    THEN("they are constructed in place and destroyed when popped"){
+      REQUIRE(pool.top(h) == "c");
+      h = pool.pop(h);
+      REQUIRE(pool.top(h) == "bbb");
+      h = pool.free_heap(h);
+      REQUIRE(pool.empty(h));
+      h = pool.push("d", h);
+      REQUIRE(pool.top(h) == "d");
+    }
+  }
+
+  GIVEN("a heap of move-only values with a custom comparison"){
+    auto cmp = [](const std::unique_ptr<int>& a, const std::unique_ptr<int>& b){
+      return *a < *b;
+    };
+    heap_pool<std::unique_ptr<int>, decltype(cmp)> pool{cmp};
+    auto h = pool.push(std::make_unique<int>(1), pool.new_heap());
+    h = pool.emplace(h, new int{3});
+    h = pool.push(std::make_unique<int>(2), h);
+
+    THEN("they are ordered through the pointers"){
+      REQUIRE(*pool.top(h) == 3);
+      h = pool.pop(h);
+      REQUIRE(*pool.top(h) == 2);
+    }
+  }
+
+  GIVEN("a comparison that throws after a given number of calls"){
+    struct throwing_less {
+      long* budget; // negative: never throws
+      bool operator()(int a, int b) const {
+        if(*budget == 0)
+          throw std::runtime_error("comparison failed");
+        if(*budget > 0)
+          --*budget;
+        return a < b;
+      }
+    };
+
+    THEN("pop leaves the heap with all its values, whenever it throws"){
+      long budget = -1;
+      int thrown = 0;
+      for(long k = 0; k < 60; ++k){
+        heap_pool<int, throwing_less, std::uint16_t> pool{throwing_less{&budget}};
+        auto h = pool.new_heap();
+        for(int i = 0; i < 64; ++i)
+          h = pool.push((i * 37) % 64, h);
+        h = pool.pop(h); // many children under the root
+        budget = k;
+        int top = 61; // 63 has been popped, 62 is popped now unless Cmp throws
+        try {
+          h = pool.pop(h);
+        } catch(const std::runtime_error&) {
+          ++thrown;
+          top = 62;
+        }
+        budget = -1;
+        std::vector<int> v;
+        for(; !pool.empty(h); h = pool.pop(h))
+          v.push_back(pool.top(h));
+        std::vector<int> expected;
+        for(int i = top; i >= 0; --i)
+          expected.push_back(i);
+        REQUIRE(v == expected);
+      }
+      REQUIRE(thrown > 0);
+    }
+
+    THEN("push leaves the heap as it was and frees the new value when it throws"){
+      struct throwing_ptr_less {
+        throwing_less less;
+        bool operator()(const std::shared_ptr<int>& a, const std::shared_ptr<int>& b) const {
+          return less(*a, *b);
+        }
+      };
+      long budget = -1;
+      heap_pool<std::shared_ptr<int>, throwing_ptr_less> pool{throwing_ptr_less{{&budget}}};
+      auto h = pool.new_heap();
+      for(int i = 0; i < 3; ++i)
+        h = pool.push(std::make_shared<int>(i), h);
+      auto p = std::make_shared<int>(10);
+      budget = 0;
+      REQUIRE_THROWS_AS(h = pool.push(p, h), std::runtime_error);
+      budget = -1;
+      REQUIRE(p.use_count() == 1);
+
+      h = pool.push(std::make_shared<int>(3), h); // reuses the freed node
+      std::vector<int> v;
+      for(; !pool.empty(h); h = pool.pop(h))
+        v.push_back(*pool.top(h));
+      REQUIRE(v == std::vector<int>{3, 2, 1, 0});
+    }
+  }
+}
@@ -0,0 +1,273 @@
+#ifndef HUGE_PAGE_STORAGE_HPP
+#define HUGE_PAGE_STORAGE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * A storage policy for large pools, whose container lives in anonymous
+ * memory obtained with mmap and backed by transparent huge pages
+ * (Linux only).
+ *
+ * With 4 KiB pages a traversal of a pool of some GB jumps to a new page
+ * at almost every node, and the TLB cannot hold the translations of so
+ * many pages: every step pays a page walk on top of the cache miss.
+ * With 2 MiB pages the same pool needs 512 times fewer translations.
+ *
+ * The mapping is aligned to a huge page and advised with
+ * madvise(MADV_HUGEPAGE), so it gets huge pages also when the system
+ * gives them only on request (transparent_hugepage/enabled = madvise).
+ * If the kernel has no transparent huge pages the advice fails and the
+ * memory is just used with normal pages: huge_pages() tells which.
+ * With Populate the pages are faulted in when mapped instead of at the
+ * first touch, so no page fault happens while pushing. MAP_POPULATE is
+ * not used because it would fault them in before the advice, with
+ * normal pages: they are populated after it, with MADV_POPULATE_WRITE
+ * (Linux 5.14) or by touching them. Only the pages added by a mapping
+ * or a growth are advised and populated, so the nodes already stored
+ * are never touched.
+ *
+ * Growing uses mremap, which extends the mapping in place when the
+ * addresses after it are free, and otherwise moves its pages without
+ * copying them to a new aligned range: the elements are relocated
+ * bitwise, so only trivially copyable elements can be stored, as in
+ * mapped_vector.
+ */
+template <typename E, bool Populate = false>
+class huge_page_vector {
+    static_assert(std::is_trivially_copyable<E>::value,
+                  "huge_page_vector can store only trivially copyable elements");
+
+public:
+    using value_type = E;
+    using size_type = std::size_t;
+
+    static constexpr size_type huge_page_size = size_type(2) << 20;
+
+    /*
+     * With Populate, whether to try MADV_POPULATE_WRITE before touching
+     * the pages one by one. Clearing it takes the path of the kernels
+     * that do not have it.
+     */
+    static inline bool use_madv_populate = true;
+
+private:
+    E* base{nullptr};
+    size_type mapped_bytes{0};
+    size_type _size{0};
+    bool huge{false};
+
+    static void check(bool ok, const char* what) {
+        if(!ok)
+            throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    static size_type round_up(size_type bytes) noexcept {
+        return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+    }
+
+    /*
+     * Asks for huge pages and, with Populate, faults the pages in.
+     * Neither is an error if the kernel does not support it. Without
+     * MADV_POPULATE_WRITE each page is touched by writing back its
+     * first byte, which leaves its content as it is.
+     */
+    void advise(void* p, size_type bytes) noexcept {
+#ifdef MADV_HUGEPAGE
+        huge = ::madvise(p, bytes, MADV_HUGEPAGE) == 0;
+#endif
+        if constexpr(Populate){
+#ifdef MADV_POPULATE_WRITE
+            if(use_madv_populate && ::madvise(p, bytes, MADV_POPULATE_WRITE) == 0)
+                return;
+#endif
+            const auto page = static_cast<size_type>(::sysconf(_SC_PAGESIZE));
+            auto c = static_cast<volatile char*>(p);
+            for(size_type i = 0; i < bytes; i += page)
+                c[i] = c[i];
+        }
+    }
+
+    /*
+     * A new mapping of bytes aligned to a huge page: a huge page more
+     * is mapped, then the unaligned head and the tail are unmapped.
+     */
+    static void* map_aligned(size_type bytes) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+        void* p = ::mmap(nullptr, bytes + huge_page_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        check(p != MAP_FAILED, "mmap");
+        auto first = reinterpret_cast<std::uintptr_t>(p);
+        auto aligned = (first + huge_page_size - 1) / huge_page_size * huge_page_size;
+        if(aligned != first)
+            ::munmap(p, aligned - first);
+        ::munmap(reinterpret_cast<void*>(aligned + bytes), first + huge_page_size - aligned);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    void map(size_type bytes) {
+        base = static_cast<E*>(map_aligned(bytes));
+        mapped_bytes = bytes;
+        advise(base, bytes);
+    }
+
+    /*
+     * The mapping is extended in place if the addresses after it are
+     * free. Otherwise an aligned destination is reserved as in map and
+     * the pages are moved there, since mremap alone may move them to
+     * an address that is not aligned to a huge page.
+     */
+    void remap(size_type bytes) {
+        void* p = ::mremap(base, mapped_bytes, bytes, 0);
+        if(p == MAP_FAILED){
+            void* dest = map_aligned(bytes);
+            p = ::mremap(base, mapped_bytes, bytes, MREMAP_MAYMOVE | MREMAP_FIXED, dest);
+            if(p == MAP_FAILED){
+                const int error = errno;
+                ::munmap(dest, bytes);
+                errno = error;
+            }
+            check(p != MAP_FAILED, "mremap");
+        }
+        base = static_cast<E*>(p);
+        const auto old_bytes = mapped_bytes;
+        mapped_bytes = bytes;
+        advise(static_cast<char*>(p) + old_bytes, bytes - old_bytes);
+    }
+
+    void unmap() noexcept {
+        if(base)
+            ::munmap(base, mapped_bytes);
+        base = nullptr;
+        mapped_bytes = 0;
+        _size = 0;
+    }
+
+public:
+    huge_page_vector() noexcept = default;
+
+    /*
+     * The memory comes from mmap, the allocator is ignored.
+     */
+    template <typename A>
+    explicit huge_page_vector(const A&) noexcept {}
+
+    std::allocator<E> get_allocator() const noexcept {
+        return {};
+    }
+
+    huge_page_vector(const huge_page_vector& o) {
+        if(o._size){
+            reserve(o._size);
+            std::memcpy(static_cast<void*>(base), o.base, o._size * sizeof(E));
+            _size = o._size;
+        }
+    }
+    huge_page_vector(huge_page_vector&& o) noexcept
+        : base{o.base}, mapped_bytes{o.mapped_bytes}, _size{o._size}, huge{o.huge} {
+        o.base = nullptr;
+        o.mapped_bytes = 0;
+        o._size = 0;
+    }
+    huge_page_vector& operator=(huge_page_vector o) noexcept {
+        std::swap(base, o.base);
+        std::swap(mapped_bytes, o.mapped_bytes);
+        std::swap(_size, o._size);
+        std::swap(huge, o.huge);
+        return *this;
+    }
+
+    ~huge_page_vector() {
+        unmap();
+    }
+
+    /*
+     * True if the kernel accepted the request for huge pages; whether
+     * it could actually find them is up to it (see AnonHugePages in
+     * /proc/meminfo).
+     */
+    bool huge_pages() const noexcept {
+        return huge;
+    }
+
+    size_type size() const noexcept {
+        return _size;
+    }
+    size_type capacity() const noexcept {
+        return mapped_bytes / sizeof(E);
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    /*
+     * The capacity is rounded up to whole huge pages.
+     */
+    void reserve(size_type n) {
+        if(n <= capacity())
+            return;
+        auto bytes = round_up(n * sizeof(E));
+        if(!base)
+            map(bytes);
+        else
+            remap(bytes);
+    }
+
+    template <typename... Args>
+    E& emplace_back(Args&&... args) {
+        if(_size == capacity())
+            reserve(std::max<size_type>(2 * _size, 1));
+        E* p = ::new (static_cast<void*>(base + _size)) E(std::forward<Args>(args)...);
+        ++_size;
+        return *p;
+    }
+
+    void pop_back() noexcept {
+        --_size;
+    }
+
+    void clear() noexcept {
+        _size = 0;
+    }
+
+    E& operator[](size_type i) noexcept {
+        return base[i];
+    }
+    const E& operator[](size_type i) const noexcept {
+        return base[i];
+    }
+
+    E* data() noexcept {
+        return base;
+    }
+    const E* data() const noexcept {
+        return base;
+    }
+};
+
+template <typename E, bool P>
+E* storage_view(huge_page_vector<E, P>& v) noexcept {
+    return v.data();
+}
+template <typename E, bool P>
+const E* storage_view(const huge_page_vector<E, P>& v) noexcept {
+    return v.data();
+}
+
+template <bool Populate = false>
+struct huge_page_storage {
+    template <typename E, typename A = std::allocator<E>>
+    using container = huge_page_vector<E, Populate>;
+};
+
+#endif // HUGE_PAGE_STORAGE_HPP
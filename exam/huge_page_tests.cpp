@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+#include "huge_page_storage.hpp"
+#include "stack_pool.hpp"
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include <sys/mman.h>
+
+SCENARIO("a pool backed by huge pages"){
+  GIVEN("a pool that grows past a few huge pages"){
+    using pool_type = stack_pool<std::uint64_t, std::uint32_t, huge_page_storage<>>;
+    pool_type pool;
+    auto l1 = pool.new_stack();
+    auto l2 = pool.new_stack();
+    for(std::uint64_t i = 0; i < (1 << 19); ++i){
+      l1 = pool.push(i, l1);
+      l2 = pool.push(2 * i, l2);
+    }
+    l2 = pool.pop_n(l2, 1000);
+
+    THEN("the values are kept across the remaps"){
+      REQUIRE(pool.capacity() >= (1 << 20));
+      REQUIRE(pool.value(l1) == (1 << 19) - 1);
+      REQUIRE(pool.value(l2) == 2 * ((1 << 19) - 1001));
+      REQUIRE(std::accumulate(pool.begin(l1), pool.end(l1), std::uint64_t(0)) ==
+              std::uint64_t(1 << 19) * ((1 << 19) - 1) / 2);
+    }
+
+    THEN("it can be copied and compacted"){
+      pool_type copy{pool};
+      REQUIRE(copy.value(l1) == pool.value(l1));
+      auto table = copy.compact();
+      REQUIRE(copy.value(table[l2]) == pool.value(l2));
+      REQUIRE(std::distance(copy.begin(table[l1]), copy.end(table[l1])) == (1 << 19));
+      pool = std::move(copy);
+      REQUIRE(pool.value(table[l1]) == (1 << 19) - 1);
+    }
+  }
+
+  GIVEN("a pool with populated pages and soa_layout"){
+    stack_pool<int, std::uint32_t, huge_page_storage<true>, soa_layout> pool{1000};
+    auto l = pool.new_stack();
+    for(int i = 0; i < 5000; ++i)
+      l = pool.push(i, l);
+
+    THEN("it works as any other pool"){
+      REQUIRE(pool.value(l) == 4999);
+      REQUIRE(std::distance(pool.begin(l), pool.end(l)) == 5000);
+      l = pool.free_stack(l);
+      REQUIRE(pool.push(1, l) == 5000);
+    }
+  }
+
+  GIVEN("a populated pool that grows by touching its pages"){
+    using pool_type = stack_pool<std::uint64_t, std::uint32_t, huge_page_storage<true>>;
+    using vector_type = huge_page_vector<aos_node<std::uint64_t, std::uint32_t>, true>;
+    vector_type::use_madv_populate = false;
+    pool_type pool;
+    auto l = pool.new_stack();
+    for(std::uint64_t i = 1; i <= (1 << 19); ++i) // the first byte of no node is 0
+      l = pool.push(i, l);
+    vector_type::use_madv_populate = true;
+
+    THEN("the nodes stored before each growth are left untouched"){
+      REQUIRE(std::distance(pool.begin(l), pool.end(l)) == (1 << 19));
+      REQUIRE(std::accumulate(pool.begin(l), pool.end(l), std::uint64_t(0)) ==
+              std::uint64_t(1 << 19) * ((1 << 19) + 1) / 2);
+    }
+  }
+
+  GIVEN("the container alone"){
+    huge_page_vector<std::uint32_t> v;
+    REQUIRE(v.capacity() == 0);
+    v.reserve(10);
+
+    THEN("it is aligned to a huge page and holds whole huge pages"){
+      using vector_type = huge_page_vector<std::uint32_t>;
+      REQUIRE(reinterpret_cast<std::uintptr_t>(v.data()) % vector_type::huge_page_size == 0);
+      REQUIRE(v.capacity() == vector_type::huge_page_size / sizeof(std::uint32_t));
+      v.emplace_back(7u);
+      v.reserve(v.capacity() + 1);
+      REQUIRE(v.capacity() == 2 * vector_type::huge_page_size / sizeof(std::uint32_t));
+      REQUIRE(v[0] == 7);
+    }
+
+    THEN("it stays aligned when a growth has to move it"){
+      using vector_type = huge_page_vector<std::uint32_t>;
+      v.emplace_back(7u);
+      // a page right after the mapping, so that it cannot grow in place
+      auto after = reinterpret_cast<char*>(v.data()) + vector_type::huge_page_size;
+      void* blocker = ::mmap(after, 4096, PROT_READ,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+      REQUIRE(blocker == after);
+      auto old = v.data();
+      v.reserve(v.capacity() + 1);
+      REQUIRE(v.data() != old);
+      REQUIRE(reinterpret_cast<std::uintptr_t>(v.data()) % vector_type::huge_page_size == 0);
+      REQUIRE(v[0] == 7);
+      ::munmap(blocker, 4096);
+    }
+  }
+}
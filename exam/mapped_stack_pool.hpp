@@ -0,0 +1,168 @@
+#ifndef MAPPED_STACK_POOL_HPP
+#define MAPPED_STACK_POOL_HPP
+
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "mapped_storage.hpp"
+#include "stack_pool.hpp"
+
+/*
+ * A stack_pool that lives in a file.
+ *
+ * Since the "address" of a node is an index and not a pointer,
+ * the nodes can be written as they are: opening the pool again maps
+ * the file and the stacks are immediately usable with the same
+ * addresses they had before, no matter where the file is mapped.
+ *
+ * The header of the file records the head of the free nodes, the
+ * number of nodes, the width of N, the version of the layout and
+ * root_count root slots, where the heads of the stacks can be kept
+ * (see set_root): then the file alone is enough to start again.
+ * Both the nodes and the header are written in the mapping as they
+ * change, so the file is consistent even if the process is killed;
+ * sync() (also called by the destructor) flushes them to the disk.
+ *
+ * Only trivially copyable T can be stored.
+ *
+ * The stack_pool is a private base: compact and load would move the
+ * nodes to a new anonymous mapping, detaching the pool from its file,
+ * so they are left out of the interface, which is otherwise the one
+ * of stack_pool.
+ */
+template <typename T, typename N = std::size_t>
+class mapped_stack_pool : private stack_pool<T, N, mapped_storage> {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "mapped_stack_pool can store only trivially copyable values");
+
+    using base = stack_pool<T, N, mapped_storage>;
+
+    void check_root(std::size_t i) const {
+        if(i >= root_count)
+            throw std::out_of_range("mapped_stack_pool: no such root slot");
+    }
+
+public:
+    using stack_type = N;
+    using value_type = T;
+    using size_type = typename base::size_type;
+    using handle_type = typename base::handle_type;
+    using mark_type = typename base::mark_type;
+    using iterator = typename base::iterator;
+    using const_iterator = typename base::const_iterator;
+
+    static constexpr std::size_t root_count = mapped_header::root_count;
+
+    /*
+     * Opens the pool stored at path, or creates an empty one.
+     * It throws std::runtime_error if the file holds a pool with
+     * a different node or index type, or if its header is corrupt.
+     */
+    explicit mapped_stack_pool(const std::string& path) {
+        this->pool.open(path);
+        auto h = this->pool.get_header();
+        if(h->index_width == 0 && h->size == 0)
+            h->index_width = sizeof(N);
+        if(h->index_width != sizeof(N)){
+            this->pool = {};
+            throw std::runtime_error(path + ": the pool was saved with a different N");
+        }
+        bool bad_root = false;
+        for(auto r : h->roots)
+            bad_root = bad_root || r > h->size;
+        if(h->size > std::numeric_limits<stack_type>::max() || h->free_nodes > h->size ||
+           bad_root){
+            this->pool = {};
+            throw std::runtime_error(path + ": corrupt header of the pool");
+        }
+        this->free_nodes = static_cast<stack_type>(h->free_nodes);
+    }
+
+    mapped_stack_pool(mapped_stack_pool&&) noexcept = default;
+    mapped_stack_pool& operator=(mapped_stack_pool&& o) {
+        sync();
+        base::operator=(std::move(o));
+        return *this;
+    }
+
+    ~mapped_stack_pool() {
+        try {
+            sync();
+        } catch(...) {
+            // nothing better to do in a destructor: the mapping is up to
+            // date, only its flush to the file may be incomplete
+        }
+    }
+
+    /*
+     * Flushes the pages to the file.
+     */
+    void sync() {
+        this->pool.sync();
+    }
+
+    /*
+     * The head stored in the root slot i, end() if none was stored.
+     * The slots are written in the header as they are set, so after a
+     * restart root(i) gives back the stacks without any other file.
+     * It is up to the caller to update a slot when the head changes
+     * (a push or a pop gives a new head) and to clear it when the
+     * stack is freed. Both throw std::out_of_range if i >= root_count.
+     * A moved-from pool has no slots: root gives end() and set_root
+     * throws std::logic_error.
+     */
+    stack_type root(std::size_t i) const {
+        check_root(i);
+        auto h = this->pool.get_header();
+        return h ? static_cast<stack_type>(h->roots[i]) : this->end();
+    }
+    void set_root(std::size_t i, stack_type head) {
+        check_root(i);
+        auto h = this->pool.get_header();
+        if(!h)
+            throw std::logic_error("mapped_stack_pool: set_root on a moved-from pool");
+        h->roots[i] = head;
+    }
+
+    using base::new_stack;
+    using base::reserve;
+    using base::capacity;
+    using base::empty;
+    using base::end;
+    using base::value;
+    using base::next;
+    using base::value_unchecked;
+    using base::next_unchecked;
+    using base::pop_unchecked;
+    using base::push;
+    using base::emplace;
+    using base::pop;
+    using base::pop_n;
+    using base::push_range;
+    using base::free_stack;
+    using base::new_handle;
+    using base::make_handle;
+    using base::size;
+    using base::back;
+    using base::concat;
+    using base::stack;
+    using base::display_stack;
+    using base::save;
+    using base::mark;
+    using base::rollback;
+    using base::commit;
+    using base::reverse;
+    using base::merge;
+    using base::sort;
+    using base::collect;
+    using base::begin;
+    using base::cbegin;
+    using base::cend;
+};
+
+#endif // MAPPED_STACK_POOL_HPP
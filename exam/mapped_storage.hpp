@@ -0,0 +1,303 @@
+#ifndef MAPPED_STORAGE_HPP
+#define MAPPED_STORAGE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * A storage policy for stack_pool whose container lives in memory
+ * obtained with mmap (Linux only).
+ *
+ * The memory is either anonymous or, after open(path), a file: in
+ * that case the nodes are the file, so a pool can be closed and opened
+ * again without any deserialization, and the kernel loads only the
+ * pages that are actually touched.
+ *
+ * The file starts with a header followed by the raw array of nodes.
+ * Since the bytes are used as they are, only trivially copyable
+ * nodes can be stored.
+ *
+ * The header ends with a few root slots, where the user of the pool
+ * keeps the heads of its stacks, so that the file alone is enough to
+ * find them again (see mapped_stack_pool::set_root).
+ */
+struct mapped_header {
+    static constexpr std::size_t root_count = 16;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t node_size;
+    std::uint32_t index_width; // sizeof(N), set by the pool
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::uint64_t capacity;
+    std::uint64_t free_nodes;  // kept up to date by the pool
+    std::uint64_t roots[root_count];
+};
+
+template <typename E>
+class mapped_vector {
+    static_assert(std::is_trivially_copyable<E>::value,
+                  "mapped_vector can store only trivially copyable elements");
+
+public:
+    using value_type = E;
+    using size_type = std::size_t;
+
+    static constexpr char magic[8] = {'s', 't', 'k', 'p', 'o', 'o', 'l', '\0'};
+    static constexpr std::uint32_t version = 2;
+
+private:
+    // the nodes start after the header, at an offset suitable for E
+    static constexpr size_type data_offset =
+        (sizeof(mapped_header) + alignof(E) - 1) / alignof(E) * alignof(E);
+    static constexpr size_type min_capacity = 64;
+
+    void* base{nullptr};
+    size_type mapped_bytes{0};
+    int fd{-1};
+
+    mapped_header& header() const noexcept {
+        return *static_cast<mapped_header*>(base);
+    }
+    E* first() const noexcept {
+        return reinterpret_cast<E*>(static_cast<char*>(base) + data_offset);
+    }
+    static size_type bytes_for(size_type n) noexcept {
+        return data_offset + n * sizeof(E);
+    }
+
+    static void check(bool ok, const char* what) {
+        if(!ok)
+            throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    /*
+     * Maps (or remaps, keeping the content) bytes_for(n) bytes.
+     * A file is extended first, so that the new pages exist.
+     */
+    void map(size_type n) {
+        auto bytes = bytes_for(n);
+        if(fd >= 0)
+            check(::ftruncate(fd, static_cast<off_t>(bytes)) == 0, "ftruncate");
+        void* p;
+        if(!base){
+            p = fd >= 0 ? ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                        : ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        } else {
+            p = ::mremap(base, mapped_bytes, bytes, MREMAP_MAYMOVE);
+        }
+        check(p != MAP_FAILED, "mmap");
+        base = p;
+        mapped_bytes = bytes;
+        header().capacity = n;
+    }
+
+    void unmap() noexcept {
+        if(base)
+            ::munmap(base, mapped_bytes);
+        if(fd >= 0)
+            ::close(fd);
+        base = nullptr;
+        mapped_bytes = 0;
+        fd = -1;
+    }
+
+    void init_header() noexcept {
+        auto& h = header();
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version = version;
+        h.node_size = sizeof(E);
+        h.index_width = 0;
+        h.size = 0;
+        h.free_nodes = 0;
+        std::fill(std::begin(h.roots), std::end(h.roots), 0);
+    }
+
+public:
+    mapped_vector() noexcept = default;
+
+    /*
+     * The memory comes from mmap, the allocator is ignored.
+     */
+    template <typename A>
+    explicit mapped_vector(const A&) noexcept {}
+
+    std::allocator<E> get_allocator() const noexcept {
+        return {};
+    }
+
+    mapped_vector(const mapped_vector&) = delete;
+    mapped_vector& operator=(const mapped_vector&) = delete;
+
+    mapped_vector(mapped_vector&& o) noexcept
+        : base{o.base}, mapped_bytes{o.mapped_bytes}, fd{o.fd} {
+        o.base = nullptr;
+        o.mapped_bytes = 0;
+        o.fd = -1;
+    }
+    mapped_vector& operator=(mapped_vector&& o) noexcept {
+        unmap();
+        std::swap(base, o.base);
+        std::swap(mapped_bytes, o.mapped_bytes);
+        std::swap(fd, o.fd);
+        return *this;
+    }
+
+    ~mapped_vector() {
+        unmap();
+    }
+
+    /*
+     * Maps the file at path, creating it if it does not exist.
+     * The current content, if any, is discarded. It throws
+     * std::system_error if the file cannot be mapped, and
+     * std::runtime_error if it is not a pool of the same nodes.
+     */
+    void open(const std::string& path) {
+        unmap();
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        check(fd >= 0, "open");
+        struct stat st;
+        check(::fstat(fd, &st) == 0, "fstat");
+        auto file_bytes = static_cast<size_type>(st.st_size);
+        if(file_bytes == 0){
+            map(min_capacity);
+            init_header();
+            return;
+        }
+        try {
+            if(file_bytes < sizeof(mapped_header))
+                throw std::runtime_error(path + ": not a stack_pool file");
+            base = ::mmap(nullptr, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(base == MAP_FAILED)
+                base = nullptr;
+            check(base != nullptr, "mmap");
+            mapped_bytes = file_bytes;
+            const auto& h = header();
+            if(std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version ||
+               h.node_size != sizeof(E) || file_bytes < data_offset ||
+               h.capacity > (file_bytes - data_offset) / sizeof(E) || h.size > h.capacity)
+                throw std::runtime_error(path + ": not a stack_pool file of this type");
+        } catch(...) {
+            unmap();
+            throw;
+        }
+    }
+
+    /*
+     * Flushes the mapped pages to the file.
+     */
+    void sync() {
+        if(fd >= 0)
+            check(::msync(base, mapped_bytes, MS_SYNC) == 0, "msync");
+    }
+
+    bool is_mapped() const noexcept {
+        return base != nullptr;
+    }
+
+    /*
+     * The header of the file, nullptr if nothing is mapped yet.
+     */
+    mapped_header* get_header() noexcept {
+        return base ? &header() : nullptr;
+    }
+    const mapped_header* get_header() const noexcept {
+        return base ? &header() : nullptr;
+    }
+
+    size_type size() const noexcept {
+        return base ? header().size : 0;
+    }
+    size_type capacity() const noexcept {
+        return base ? header().capacity : 0;
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    void reserve(size_type n) {
+        if(!base){
+            map(std::max(n, min_capacity));
+            init_header();
+        } else if(n > capacity()) {
+            map(n);
+        }
+    }
+
+    template <typename... Args>
+    E& emplace_back(Args&&... args) {
+        if(size() == capacity())
+            reserve(2 * capacity());
+        E* p = ::new (static_cast<void*>(first() + size())) E(std::forward<Args>(args)...);
+        ++header().size;
+        return *p;
+    }
+
+    void pop_back() noexcept {
+        --header().size;
+    }
+
+    void clear() noexcept {
+        if(base)
+            header().size = 0;
+    }
+
+    E& operator[](size_type i) noexcept {
+        return first()[i];
+    }
+    const E& operator[](size_type i) const noexcept {
+        return first()[i];
+    }
+
+    E* data() noexcept {
+        return base ? first() : nullptr;
+    }
+    const E* data() const noexcept {
+        return base ? first() : nullptr;
+    }
+};
+
+template <typename E>
+E* storage_view(mapped_vector<E>& v) noexcept {
+    return v.data();
+}
+template <typename E>
+const E* storage_view(const mapped_vector<E>& v) noexcept {
+    return v.data();
+}
+
+/*
+ * The head of the free nodes goes straight to the header, so that the
+ * file never holds nodes newer than its free nodes.
+ */
+template <typename E, typename N>
+void store_free_head(mapped_vector<E>& v, N head) noexcept {
+    if(auto h = v.get_header())
+        h->free_nodes = head;
+}
+
+struct mapped_storage {
+    template <typename E, typename A = std::allocator<E>>
+    using container = mapped_vector<E>;
+};
+
+#endif // MAPPED_STORAGE_HPP
@@ -0,0 +1,150 @@
+#include "catch.hpp"
+
+#include "mapped_stack_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+  std::string temporary_path(const char* name) {
+    return "/tmp/" + std::string(name) + "." + std::to_string(::getpid());
+  }
+}
+
+// compact and load would detach the pool from its file
+static_assert(!std::is_convertible<mapped_stack_pool<double, std::uint32_t>&,
+                                   stack_pool<double, std::uint32_t, mapped_storage>&>::value,
+              "the stack_pool of a mapped_stack_pool must not be reachable");
+
+SCENARIO("a pool stored in a file"){
+  GIVEN("a pool created from scratch"){
+    const auto path = temporary_path("mapped_pool");
+    std::remove(path.c_str());
+    std::uint32_t l1, l2;
+    {
+      mapped_stack_pool<double, std::uint32_t> pool{path};
+      l1 = pool.new_stack();
+      l2 = pool.new_stack();
+      for(int i = 0; i < 1000; ++i){
+        l1 = pool.push(i, l1);
+        l2 = pool.push(-i, l2);
+      }
+      l2 = pool.pop_n(l2, 10);
+      REQUIRE(pool.capacity() >= 2000);
+      pool.set_root(0, l1);
+      pool.set_root(3, l2);
+    }
+
+    WHEN("the file is opened again"){
+      mapped_stack_pool<double, std::uint32_t> pool{path};
+
+      THEN("the stacks are there, with the same addresses"){
+        REQUIRE(pool.value(l1) == 999);
+        REQUIRE(pool.value(l2) == -989);
+        REQUIRE(std::distance(pool.begin(l1), pool.end(l1)) == 1000);
+      }
+
+      THEN("the heads are found in the root slots"){
+        REQUIRE(pool.root(0) == l1);
+        REQUIRE(pool.root(3) == l2);
+        REQUIRE(pool.empty(pool.root(1)));
+        REQUIRE(pool.value(pool.root(3)) == -989);
+        REQUIRE_THROWS_AS(pool.root(pool.root_count), std::out_of_range);
+      }
+
+      THEN("a moved-from pool has no root slots"){
+        auto other = std::move(pool);
+        REQUIRE(other.root(0) == l1);
+        REQUIRE(pool.empty(pool.root(0)));
+        REQUIRE_THROWS_AS(pool.set_root(0, l1), std::logic_error);
+      }
+
+      THEN("the free nodes are reused"){
+        auto capacity = pool.capacity();
+        for(int i = 0; i < 10; ++i)
+          l2 = pool.push(i, l2);
+        REQUIRE(l2 <= 2000);
+        REQUIRE(pool.capacity() == capacity);
+      }
+    }
+
+    WHEN("the file is copied while the pool is still open, as if the process was killed"){
+      const auto copy = temporary_path("mapped_pool_copy");
+      {
+        mapped_stack_pool<double, std::uint32_t> pool{path};
+        l2 = pool.push(1.5, l2); // reuses the first free node recorded in the file
+        l1 = pool.pop_n(l1, 500);
+        std::ifstream from{path, std::ios::binary};
+        std::ofstream to{copy, std::ios::binary};
+        to << from.rdbuf();
+        pool.free_stack(l1);
+        pool.free_stack(l2);
+      }
+      mapped_stack_pool<double, std::uint32_t> pool{copy};
+
+      THEN("the free nodes of the copy are the current ones"){
+        REQUIRE(pool.value(l1) == 499);
+        REQUIRE(pool.value(l2) == 1.5);
+        auto l3 = pool.new_stack();
+        for(int i = 0; i < 509; ++i)
+          l3 = pool.push(-1, l3);
+        REQUIRE(pool.capacity() >= 2000);
+        REQUIRE(std::distance(pool.begin(l1), pool.end(l1)) == 500);
+        REQUIRE(std::distance(pool.begin(l2), pool.end(l2)) == 991);
+        REQUIRE(pool.value(l2) == 1.5);
+      }
+      std::remove(copy.c_str());
+    }
+
+    WHEN("the head of the free nodes in the file is out of range"){
+      {
+        std::fstream f{path, std::ios::binary | std::ios::in | std::ios::out};
+        f.seekp(offsetof(mapped_header, free_nodes));
+        std::uint64_t bad = 5000;
+        f.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+      }
+      using pool_type = mapped_stack_pool<double, std::uint32_t>;
+      REQUIRE_THROWS_AS(pool_type{path}, std::runtime_error);
+    }
+
+    WHEN("a root slot in the file is out of range"){
+      {
+        std::fstream f{path, std::ios::binary | std::ios::in | std::ios::out};
+        f.seekp(offsetof(mapped_header, roots) + 5 * sizeof(std::uint64_t));
+        std::uint64_t bad = 5000;
+        f.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+      }
+      using pool_type = mapped_stack_pool<double, std::uint32_t>;
+      REQUIRE_THROWS_AS(pool_type{path}, std::runtime_error);
+    }
+
+    WHEN("the file is opened with another index type"){
+      using other = mapped_stack_pool<double, std::uint64_t>;
+      REQUIRE_THROWS_AS(other{path}, std::runtime_error);
+    }
+
+    WHEN("the file is opened with another value type"){
+      using other = mapped_stack_pool<float, std::uint32_t>;
+      REQUIRE_THROWS_AS(other{path}, std::runtime_error);
+    }
+
+    std::remove(path.c_str());
+  }
+
+  GIVEN("a pool with mapped storage but no file"){
+    stack_pool<int, std::uint16_t, mapped_storage> pool{};
+    auto l = pool.new_stack();
+    for(int i = 0; i < 100; ++i)
+      l = pool.push(i, l);
+    REQUIRE(pool.value(l) == 99);
+    l = pool.free_stack(l);
+    REQUIRE(pool.empty(l));
+  }
+}
@@ -0,0 +1,206 @@
+#ifndef PERSISTENT_STACK_POOL_HPP
+#define PERSISTENT_STACK_POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "stack_pool.hpp"
+
+/*
+ * A pool of persistent stacks: stacks that share their tails.
+ *
+ * Every node carries the number of references to it, i.e. the stacks
+ * held by the user whose head it is plus the nodes whose next it is.
+ * Then:
+ * - fork(x) gives a second stack equal to x in O(1), without copying;
+ * - push on a shared stack adds one node on top of it, the tail is
+ *   not copied;
+ * - pop and free_stack give back to the free nodes only the nodes
+ *   that are no longer referenced by anybody.
+ *
+ * A stack is a handle owning one reference: push, pop and free_stack
+ * consume the handle they are given, and whoever needs to keep using
+ * it must fork it first. Since the nodes may be shared, their values
+ * can be read but not modified.
+ *
+ * The nodes are kept in a stack_pool, the counts in a parallel vector.
+ */
+template <typename T, typename N = std::size_t,
+          typename Storage = vector_storage, typename Layout = aos_layout>
+class persistent_stack_pool {
+    using pool_type = stack_pool<T, N, Storage, Layout>;
+    pool_type pool;
+    std::vector<std::size_t> refs; // refs[x - 1]: references to the node x
+
+public:
+    using stack_type = N;
+    using value_type = T;
+    using size_type = std::size_t;
+    using const_iterator = typename pool_type::const_iterator;
+
+private:
+    std::size_t& count(stack_type x) noexcept {
+        return refs[x - 1];
+    }
+
+    void check_logic_error(stack_type x, const char* message) const {
+        if(empty(x))
+            throw std::out_of_range(message);
+    }
+
+    /*
+     * A stack that can be used in a range based for loop.
+     */
+    class _stack {
+        const_iterator first, last;
+    public:
+        _stack(const_iterator f, const_iterator l) noexcept
+            : first{f}, last{l} {};
+        const_iterator begin() const noexcept { return first; }
+        const_iterator end() const noexcept { return last; }
+    };
+
+public:
+    persistent_stack_pool() = default;
+
+    explicit persistent_stack_pool(size_type n) {
+        reserve(n);
+    }
+
+    stack_type new_stack() const noexcept {
+        return end();
+    }
+
+    stack_type end() const noexcept {
+        return stack_type(0);
+    }
+
+    bool empty(stack_type x) const noexcept {
+        return x == end();
+    }
+
+    void reserve(size_type n) {
+        pool.reserve(n);
+        refs.reserve(n);
+    }
+
+    size_type capacity() const noexcept {
+        return pool.capacity();
+    }
+
+    /*
+     * The number of references to the head of x: 1 if x is not
+     * shared, 0 if x is empty.
+     */
+    size_type use_count(stack_type x) const noexcept {
+        return empty(x) ? 0 : refs[x - 1];
+    }
+
+    const T& value(stack_type x) const {
+        return pool.value(x);
+    }
+
+    stack_type next(stack_type x) const {
+        return pool.next(x);
+    }
+
+    /*
+     * Another handle to the same stack, in O(1).
+     */
+    stack_type fork(stack_type x) noexcept {
+        if(!empty(x))
+            ++count(x);
+        return x;
+    }
+
+    /*
+     * The reference held by head passes to the new node.
+     */
+    stack_type push(const T& val, stack_type head) {
+        return emplace(head, val);
+    }
+    stack_type push(T&& val, stack_type head) {
+        return emplace(head, std::move(val));
+    }
+
+    template <typename... Args>
+    stack_type emplace(stack_type head, Args&&... args);
+
+    /*
+     * Returns the rest of the stack x. If nobody else refers to the
+     * head of x, the node is freed and its reference to the rest
+     * passes to the returned handle, otherwise the head stays where
+     * it is and the rest gains a reference.
+     * It throws std::out_of_range if x is empty.
+     */
+    stack_type pop(stack_type x);
+
+    /*
+     * Drops the handle x: the nodes that were referenced only through
+     * x are freed, up to the first node that is shared with another
+     * stack. Returns an empty stack.
+     * As stack_pool::free_stack, it is noexcept only with -DNDEBUG.
+     */
+    stack_type free_stack(stack_type x) noexcept(!pool_type::debug_checks);
+
+    const_iterator begin(stack_type x) const noexcept {
+        return pool.cbegin(x);
+    }
+    const_iterator end(stack_type x) const noexcept {
+        return pool.cend(x);
+    }
+
+    auto stack(stack_type x) const noexcept {
+        return _stack{begin(x), end(x)};
+    }
+};
+
+/*
+ * If the vector of the counts cannot grow, the node is popped
+ * and the pool is left as it was.
+ */
+template <typename T, typename N, typename S, typename L>
+template <typename... Args>
+N persistent_stack_pool<T, N, S, L>::emplace(N head, Args&&... args) {
+    auto x = pool.emplace(head, std::forward<Args>(args)...);
+    if(refs.size() < x){
+        try {
+            refs.resize(std::max<size_type>(x, pool.capacity()));
+        } catch(...) {
+            pool.pop(x);
+            throw;
+        }
+    }
+    count(x) = 1;
+    return x;
+};
+
+template <typename T, typename N, typename S, typename L>
+N persistent_stack_pool<T, N, S, L>::pop(N x){
+    check_logic_error(x, "Requested pop on empty stack");
+    if(count(x) == 1)
+        return pool.pop_unchecked(x);
+    --count(x);
+    return fork(pool.next_unchecked(x));
+};
+
+/*
+ * The nodes to be freed form a prefix of the stack:
+ * they go back to the free nodes with a single relink.
+ */
+template <typename T, typename N, typename S, typename L>
+N persistent_stack_pool<T, N, S, L>::free_stack(N x) noexcept(!pool_type::debug_checks) {
+    if(empty(x) || --count(x))
+        return end();
+    auto last = x;
+    for(auto rest = pool.next_unchecked(last); !empty(rest) && --count(rest) == 0;
+        rest = pool.next_unchecked(rest))
+        last = rest;
+    pool.free_stack(x, last);
+    return end();
+};
+
+#endif // PERSISTENT_STACK_POOL_HPP
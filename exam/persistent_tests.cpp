@@ -0,0 +1,92 @@
+#include "catch.hpp"
+
+#include "persistent_stack_pool.hpp"
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <vector>
+
+SCENARIO("stacks that share their tails"){
+  GIVEN("a stack and a fork of it"){
+    persistent_stack_pool<int, std::uint16_t> pool;
+    auto a = pool.new_stack();
+    for(int i = 1; i <= 3; ++i)
+      a = pool.push(i, a);
+    auto b = pool.fork(a);
+
+    THEN("the fork is the same stack, not a copy"){
+      REQUIRE(b == a);
+      REQUIRE(pool.use_count(a) == 2);
+      REQUIRE(pool.capacity() >= 3);
+    }
+
+    WHEN("both are pushed on"){
+      a = pool.push(10, a);
+      b = pool.push(20, b);
+
+      THEN("the tail is shared"){
+        REQUIRE(pool.next(a) == pool.next(b));
+        REQUIRE(pool.use_count(pool.next(a)) == 2);
+        REQUIRE(std::accumulate(pool.begin(a), pool.end(a), 0) == 16);
+        REQUIRE(std::accumulate(pool.begin(b), pool.end(b), 0) == 26);
+      }
+
+      THEN("freeing one stack frees only its own nodes"){
+        a = pool.free_stack(a);
+        REQUIRE(pool.empty(a));
+        REQUIRE(pool.use_count(pool.next(b)) == 1);
+        std::vector<int> rest;
+        for(auto x : pool.stack(b))
+          rest.push_back(x);
+        REQUIRE(rest == std::vector<int>{20, 3, 2, 1});
+
+        auto c = pool.push(30, pool.new_stack());
+        REQUIRE(c == 4); // the node of 10
+      }
+    }
+
+    WHEN("a shared stack is popped"){
+      auto rest = pool.pop(b);
+
+      THEN("its head stays for the other stack"){
+        REQUIRE(pool.value(a) == 3);
+        REQUIRE(pool.use_count(a) == 1);
+        REQUIRE(pool.value(rest) == 2);
+        REQUIRE(pool.use_count(rest) == 2);
+      }
+
+      THEN("popping it again frees nothing else"){
+        rest = pool.pop(rest);
+        rest = pool.pop(rest);
+        REQUIRE(pool.empty(rest));
+        REQUIRE(std::distance(pool.begin(a), pool.end(a)) == 3);
+        REQUIRE_THROWS_AS(pool.pop(rest), std::out_of_range);
+      }
+    }
+
+    WHEN("all the handles are dropped"){
+      pool.free_stack(a);
+      pool.free_stack(b);
+
+      THEN("every node is free again"){
+        auto c = pool.new_stack();
+        for(int i = 0; i < 3; ++i)
+          c = pool.push(i, c);
+        REQUIRE(c <= 3);
+        REQUIRE(pool.use_count(c) == 1);
+      }
+    }
+  }
+
+  GIVEN("values that own resources"){
+    persistent_stack_pool<std::string> pool;
+    auto a = pool.push("tail", pool.new_stack());
+    auto b = pool.push("b", pool.fork(a));
+    a = pool.push("a", a);
+    b = pool.free_stack(b);
+    REQUIRE(pool.value(pool.next(a)) == "tail");
+    a = pool.pop(a);
+    REQUIRE(pool.value(a) == "tail");
+    REQUIRE(pool.use_count(a) == 1);
+  }
+}
@@ -0,0 +1,238 @@
+#ifndef POOL_ALGORITHMS_HPP
+#define POOL_ALGORITHMS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Algorithms over many stacks of the same pool.
+ *
+ * The pool is only read, through its const iterators, so any number
+ * of threads can walk it at the same time as long as nobody modifies
+ * it meanwhile. They work with every pool that has cbegin and cend
+ * (stack_pool, static_stack_pool, unrolled_stack_pool...).
+ *
+ * The first argument is the execution policy: sequenced_policy{} runs
+ * everything on the calling thread, parallel_policy{n} on n threads
+ * (by default one per core).
+ * The standard execution policies are not used on purpose: with GCC
+ * they need TBB, and we want to pick the number of threads.
+ */
+struct sequenced_policy {};
+
+struct parallel_policy {
+    unsigned threads;
+
+    explicit parallel_policy(unsigned n = std::thread::hardware_concurrency()) noexcept
+        : threads{n ? n : 1} {}
+};
+
+namespace detail {
+    /*
+     * Runs job(t, first, last) on blocks [first, last) of the indices
+     * in [0, n), taken by the threads from a shared counter, so that a
+     * thread that gets short stacks just takes more blocks; t is the
+     * thread it runs on. The first exception thrown by a job
+     * stops the others (at the end of their block) and is rethrown.
+     */
+    template <typename Job>
+    void run_blocks(const parallel_policy& policy, std::size_t n, Job job) {
+        const std::size_t threads = std::min<std::size_t>(policy.threads, n);
+        if(threads <= 1){
+            if(n)
+                job(0, 0, n);
+            return;
+        }
+        const std::size_t block = std::max<std::size_t>(1, n / (threads * 16));
+        std::atomic<std::size_t> next{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto worker = [&](std::size_t t){
+            try {
+                for(;;){
+                    if(failed.load(std::memory_order_relaxed))
+                        return;
+                    auto first = next.fetch_add(block, std::memory_order_relaxed);
+                    if(first >= n)
+                        return;
+                    job(t, first, std::min(n, first + block));
+                }
+            } catch(...) {
+                std::lock_guard<std::mutex> lock{error_mutex};
+                if(!error)
+                    error = std::current_exception();
+                failed = true;
+            }
+        };
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        try {
+            for(std::size_t t = 1; t < threads; ++t)
+                pool.emplace_back(worker, t);
+        } catch(...) {
+            failed = true; // the threads already started stop soon
+            for(auto& th : pool)
+                th.join();
+            throw;
+        }
+        worker(0);
+        for(auto& th : pool)
+            th.join();
+        if(error)
+            std::rethrow_exception(error);
+    }
+}
+
+/*
+ * Calls f(head, first, last) for every head in heads, where
+ * [first, last) are the const iterators over the stack.
+ * With a parallel_policy, f is called concurrently and in no
+ * particular order.
+ */
+template <typename Pool, typename Heads, typename F>
+void for_each_stack(sequenced_policy, const Pool& pool, const Heads& heads, F f) {
+    for(auto h : heads)
+        f(h, pool.cbegin(h), pool.cend(h));
+}
+
+template <typename Pool, typename Heads, typename F>
+void for_each_stack(const parallel_policy& policy, const Pool& pool, const Heads& heads, F f) {
+    auto first = std::begin(heads);
+    const auto n = static_cast<std::size_t>(std::distance(first, std::end(heads)));
+    detail::run_blocks(policy, n, [&](std::size_t, std::size_t i, std::size_t last){
+        for(auto it = std::next(first, i); i < last; ++i, ++it)
+            f(*it, pool.cbegin(*it), pool.cend(*it));
+    });
+}
+
+/*
+ * Returns the reduction with reduce of init and of
+ * transform(head, first, last) for every head in heads.
+ * With a parallel_policy, reduce must be associative and commutative,
+ * as for std::transform_reduce: every thread reduces the stacks it
+ * walks in a local result, then the results of the threads are reduced.
+ */
+template <typename Pool, typename Heads, typename V, typename Reduce, typename Transform>
+V transform_reduce_stacks(sequenced_policy, const Pool& pool, const Heads& heads, V init,
+                          Reduce reduce, Transform transform) {
+    for(auto h : heads)
+        init = reduce(std::move(init), transform(h, pool.cbegin(h), pool.cend(h)));
+    return init;
+}
+
+template <typename Pool, typename Heads, typename V, typename Reduce, typename Transform>
+V transform_reduce_stacks(const parallel_policy& policy, const Pool& pool, const Heads& heads,
+                          V init, Reduce reduce, Transform transform) {
+    auto first = std::begin(heads);
+    const auto n = static_cast<std::size_t>(std::distance(first, std::end(heads)));
+    // one partial result per thread, padded to avoid false sharing
+    struct alignas(64) partial {
+        std::optional<V> value;
+    };
+    std::vector<partial> partials(policy.threads);
+    detail::run_blocks(policy, n, [&](std::size_t t, std::size_t i, std::size_t last){
+        auto& p = partials[t];
+        for(auto it = std::next(first, i); i < last; ++i, ++it){
+            auto v = transform(*it, pool.cbegin(*it), pool.cend(*it));
+            if(p.value)
+                p.value = reduce(std::move(*p.value), std::move(v));
+            else
+                p.value = std::move(v);
+        }
+    });
+    for(auto& p : partials)
+        if(p.value)
+            init = reduce(std::move(init), std::move(*p.value));
+    return init;
+}
+
+namespace detail {
+    inline void prefetch(const void* p) noexcept {
+#if defined(__GNUC__)
+        __builtin_prefetch(p);
+#else
+        (void)p;
+#endif
+    }
+
+    /*
+     * Both the next and the value, which with soa_layout live
+     * in different arrays.
+     */
+    template <typename Pool, typename N>
+    void prefetch_node(Pool& pool, N x) noexcept {
+        prefetch(&pool.next_unchecked(x));
+        prefetch(&pool.value_unchecked(x));
+    }
+}
+
+/*
+ * Calls f(head, value) for every value of the stacks in heads, walking
+ * width stacks at a time, round robin: before moving to the next stack
+ * the next node of the current one is prefetched, so that up to width
+ * misses are in flight at once instead of one. Each stack is visited
+ * from the top, but the values of different stacks are interleaved.
+ * It works with the pools that have value_unchecked and next_unchecked
+ * (stack_pool and its derived pools).
+ *
+ * The address of a node is known only once its previous node has been
+ * loaded, so the nodes of a single stack cannot be fetched ahead: on a
+ * fragmented pool larger than the last-level cache every step of a
+ * traversal waits for a miss. Only independent chains can overlap
+ * their misses, hence the interleaving.
+ */
+template <typename Pool, typename Heads, typename F>
+void for_each_stack_prefetch(Pool& pool, const Heads& heads, F f, std::size_t width = 16) {
+    using N = std::decay_t<decltype(*std::begin(heads))>;
+    struct cursor {
+        N head;
+        N x;
+    };
+    auto first = std::begin(heads);
+    auto last = std::end(heads);
+    // the next non empty stack, if any, into c
+    auto start = [&](cursor& c){
+        for(; first != last; ++first){
+            if(*first){
+                c = {*first, *first};
+                detail::prefetch_node(pool, c.x);
+                ++first;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<cursor> active(std::max<std::size_t>(width, 1));
+    std::size_t n = 0;
+    while(n < active.size() && start(active[n]))
+        ++n;
+    while(n){
+        for(std::size_t i = 0; i < n;){
+            auto& c = active[i];
+            f(c.head, pool.value_unchecked(c.x));
+            c.x = pool.next_unchecked(c.x);
+            if(c.x)
+                detail::prefetch_node(pool, c.x);
+            else if(!start(c)){
+                c = active[--n];
+                continue;
+            }
+            ++i;
+        }
+    }
+}
+
+#endif // POOL_ALGORITHMS_HPP
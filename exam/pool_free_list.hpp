@@ -0,0 +1,171 @@
+#ifndef POOL_FREE_LIST_HPP
+#define POOL_FREE_LIST_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Free-list policies for stack_pool: which free node a push takes.
+ *
+ * lifo_free_list, the default, is the chain of free_nodes: a push
+ * takes the node popped last, in O(1) and with no extra memory, but
+ * under churn the nodes of a stack end up spread all over the pool.
+ *
+ * The other policies keep the free nodes in a bitmap (one bit per
+ * node, plus one bit per 64 nodes and one per 4096 nodes to skip the
+ * full words), which lets them choose:
+ * - ordered_free_list takes the free node with the lowest address,
+ *   so the live nodes stay packed at the front of the pool;
+ * - near_head_free_list<BlockBytes> takes a free node in the same
+ *   block of BlockBytes bytes (a cache line, a page) as the head of
+ *   the stack, if any, otherwise the lowest one.
+ *
+ * The features that walk or record the chain of free nodes (mark and
+ * rollback, compact, collect, save and load) need lifo_free_list.
+ */
+struct lifo_free_list {
+    static constexpr bool chained = true;
+};
+
+/*
+ * The free nodes, by address (index plus one, 0 being none).
+ * A set bit in words is a free node, a set bit in summary is a word
+ * with at least one free node, a set bit in top is a summary word
+ * with at least one set bit; lowest is the first top word that can
+ * have set bits.
+ * With two levels only, taking the lowest node after a node was
+ * given back below the others rescanned the summary from there, up
+ * to one word per 4096 nodes of the pool; with top the scan is at
+ * most one word per 2^18 nodes.
+ */
+class free_bitmap {
+    static constexpr std::size_t bits = 64;
+
+    std::vector<std::uint64_t> words;
+    std::vector<std::uint64_t> summary;
+    std::vector<std::uint64_t> top;
+    std::size_t lowest{0};
+    std::size_t count{0};
+
+    /*
+     * The index of the lowest bit set in w, which must not be 0.
+     */
+    static std::size_t first_bit(std::uint64_t w) noexcept {
+#if defined(__GNUC__)
+        return static_cast<std::size_t>(__builtin_ctzll(w));
+#else
+        std::size_t i = 0;
+        for(; !(w & 1); w >>= 1)
+            ++i;
+        return i;
+#endif
+    }
+
+    /*
+     * Clears bit i and returns its address.
+     */
+    std::size_t take_bit(std::size_t i) noexcept {
+        auto w = i / bits;
+        auto s = w / bits;
+        // the upper bits are cleared without branches, which would
+        // be mispredicted about as often as a word becomes empty
+        words[w] &= ~(std::uint64_t(1) << (i % bits));
+        summary[s] &= ~(std::uint64_t(words[w] == 0) << (w % bits));
+        top[s / bits] &= ~(std::uint64_t(summary[s] == 0) << (s % bits));
+        --count;
+        return i + 1;
+    }
+
+protected:
+    /*
+     * The free node with the lowest address, 0 if there is none.
+     */
+    std::size_t take_lowest() noexcept {
+        for(; lowest < top.size(); ++lowest){
+            if(top[lowest]){
+                auto s = lowest * bits + first_bit(top[lowest]);
+                auto w = s * bits + first_bit(summary[s]);
+                return take_bit(w * bits + first_bit(words[w]));
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * The first free node in the addresses [first + 1, last + 1),
+     * 0 if there is none.
+     */
+    std::size_t take_in(std::size_t first, std::size_t last) noexcept {
+        last = std::min(last, words.size() * bits);
+        while(first < last){
+            auto w = first / bits;
+            auto m = words[w] >> (first % bits);
+            auto n = std::min(last - first, bits - first % bits);
+            if(n < bits)
+                m &= (std::uint64_t(1) << n) - 1;
+            if(m)
+                return take_bit(first + first_bit(m));
+            first += n;
+        }
+        return 0;
+    }
+
+public:
+    /*
+     * Room for the addresses up to n; it may throw std::bad_alloc.
+     */
+    void reserve_free(std::size_t n) {
+        auto w = (n + bits - 1) / bits;
+        if(w > words.size()){
+            w = std::max(w, 2 * words.size());
+            auto s = (w + bits - 1) / bits;
+            top.resize((s + bits - 1) / bits, 0);
+            summary.resize(s, 0);
+            words.resize(w, 0);
+        }
+    }
+
+    void give_free(std::size_t x) noexcept {
+        auto i = x - 1;
+        auto w = i / bits;
+        auto s = w / bits;
+        words[w] |= std::uint64_t(1) << (i % bits);
+        summary[s] |= std::uint64_t(1) << (w % bits);
+        top[s / bits] |= std::uint64_t(1) << (s % bits);
+        lowest = std::min(lowest, s / bits);
+        ++count;
+    }
+
+    bool has_free() const noexcept {
+        return count != 0;
+    }
+};
+
+struct ordered_free_list : free_bitmap {
+    static constexpr bool chained = false;
+
+    template <std::size_t NodeSize>
+    std::size_t take_free(std::size_t) noexcept {
+        return take_lowest();
+    }
+};
+
+template <std::size_t BlockBytes = 4096>
+struct near_head_free_list : free_bitmap {
+    static constexpr bool chained = false;
+
+    template <std::size_t NodeSize>
+    std::size_t take_free(std::size_t head) noexcept {
+        constexpr std::size_t block = std::max<std::size_t>(1, BlockBytes / NodeSize);
+        if(head){
+            auto first = (head - 1) / block * block;
+            if(auto x = take_in(first, first + block))
+                return x;
+        }
+        return take_lowest();
+    }
+};
+
+#endif // POOL_FREE_LIST_HPP
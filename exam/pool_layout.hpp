@@ -0,0 +1,284 @@
+#ifndef POOL_LAYOUT_HPP
+#define POOL_LAYOUT_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "pool_storage.hpp"
+
+/*
+ * Layout policies for stack_pool.
+ *
+ * A layout policy decides how the value and the next of a node are
+ * placed in memory: policy::nodes<T, N, Storage, A> is the container of
+ * all the nodes of the pool, built on the containers given by the
+ * storage policy with (a rebound copy of) the allocator A.
+ * Whatever the layout, nodes[i] gives something with two members,
+ * value and next, referring to the node of index i, and
+ * nodes.emplace_back(next, args...) appends a new node whose value
+ * is constructed from args.
+ */
+
+/*
+ * The place where the value of a node lives.
+ *
+ * The value is constructed in place when the node is pushed and,
+ * unless T is trivially destructible, destroyed as soon as the node
+ * is popped: a free node does not keep alive the resources of the
+ * last value it held (e.g. the memory owned by a std::unique_ptr).
+ * Hence the anonymous union, which lets us decide when the value
+ * lives, and the flag, which tells the copy and move constructors
+ * (used when the storage grows) whether there is a value to copy.
+ *
+ * For trivially destructible T there is nothing to destroy: the slot
+ * is just a T, with no flag, and destroy() does nothing.
+ */
+template <typename T, bool = std::is_trivially_destructible<T>::value>
+struct value_slot {
+    T value;
+
+    template <typename... Args>
+    explicit value_slot(std::in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...) {};
+
+    template <typename... Args>
+    void construct(Args&&... args) {
+        ::new (static_cast<void*>(&value)) T(std::forward<Args>(args)...);
+    }
+    void destroy() noexcept {}
+};
+
+template <typename T>
+struct value_slot<T, false> {
+    union {
+        T value;
+    };
+    bool live;
+
+    template <typename... Args>
+    explicit value_slot(std::in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...), live{true} {};
+
+    value_slot(const value_slot& o) : live{false} {
+        if(o.live)
+            construct(o.value);
+    }
+    value_slot(value_slot&& o) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : live{false} {
+        if(o.live)
+            construct(std::move(o.value));
+    }
+
+    value_slot& operator=(const value_slot& o) {
+        if(live && o.live)
+            value = o.value;
+        else if(this != &o){
+            destroy();
+            if(o.live)
+                construct(o.value);
+        }
+        return *this;
+    }
+    value_slot& operator=(value_slot&& o) noexcept(std::is_nothrow_move_assignable<T>::value &&
+                                                 std::is_nothrow_move_constructible<T>::value) {
+        if(live && o.live)
+            value = std::move(o.value);
+        else if(this != &o){
+            destroy();
+            if(o.live)
+                construct(std::move(o.value));
+        }
+        return *this;
+    }
+
+    ~value_slot() {
+        destroy();
+    }
+
+    template <typename... Args>
+    void construct(Args&&... args) {
+        ::new (static_cast<void*>(&value)) T(std::forward<Args>(args)...);
+        live = true;
+    }
+    void destroy() noexcept {
+        if(live){
+            value.~T();
+            live = false;
+        }
+    }
+};
+
+/*
+ * Array of structures: value and next side by side,
+ * as in the original stack_pool.
+ */
+template <typename T, typename N>
+struct aos_node : value_slot<T> {
+    N next;
+    template <typename... Args>
+        aos_node(N n, Args&&... args)
+        : value_slot<T>{std::in_place, std::forward<Args>(args)...}, next{n} {};
+};
+
+/*
+ * Besides the container of the nodes, a layout gives the way to
+ * construct the value of an existing node and to destroy it.
+ */
+struct aos_layout {
+    template <typename T, typename N, typename Storage, typename A>
+    using nodes = typename Storage::template container<aos_node<T, N>, A>;
+
+    // the bytes taken by a node, as reported by stack_pool::stats()
+    template <typename T, typename N>
+    static constexpr std::size_t node_size = sizeof(aos_node<T, N>);
+
+    template <typename Nodes, typename... Args>
+    static void construct(Nodes& n, std::size_t i, Args&&... args) {
+        n[i].construct(std::forward<Args>(args)...);
+    }
+    template <typename Nodes>
+    static void destroy(Nodes& n, std::size_t i) noexcept {
+        n[i].destroy();
+    }
+};
+
+/*
+ * Structure of arrays: the values and the next indices are stored
+ * in two separate containers, so that walking a stack (or freeing it)
+ * touches only the indices and no memory is wasted in padding,
+ * e.g. a node of a stack_pool<char, std::size_t> takes 9 bytes
+ * instead of 16.
+ */
+template <typename V, typename M>
+struct soa_node_ref {
+    V& value;
+    M& next;
+};
+
+template <typename T, typename N, typename Storage, typename A>
+class soa_nodes {
+    using values_type = typename Storage::template container<value_slot<T>, A>;
+    using nexts_type = typename Storage::template container<N, A>;
+    values_type values;
+    nexts_type nexts;
+
+public:
+    using size_type = typename nexts_type::size_type;
+    using allocator_type = A;
+
+    soa_nodes() = default;
+    explicit soa_nodes(const A& a) : values(a), nexts(a) {}
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(values.get_allocator());
+    }
+
+    /*
+     * The view used by the iterators is a pair of views,
+     * one for each container.
+     */
+    template <typename VV, typename NV>
+    struct view {
+        VV values;
+        NV nexts;
+        auto operator[](size_type i) const noexcept {
+            using V = std::remove_reference_t<decltype((values[i].value))>;
+            using M = std::remove_reference_t<decltype(nexts[i])>;
+            return soa_node_ref<V, M>{values[i].value, nexts[i]};
+        }
+    };
+
+    size_type size() const noexcept {
+        return nexts.size();
+    }
+    size_type capacity() const noexcept {
+        return std::min<size_type>(values.capacity(), nexts.capacity());
+    }
+    void reserve(size_type n) {
+        values.reserve(n);
+        nexts.reserve(n);
+    }
+
+    /*
+     * If the second emplace_back throws, the value is removed so that
+     * the two containers always have the same size.
+     */
+    template <typename... Args>
+    soa_node_ref<T, N> emplace_back(N n, Args&&... args) {
+        values.emplace_back(std::in_place, std::forward<Args>(args)...);
+        try {
+            nexts.emplace_back(n);
+        } catch(...) {
+            values.pop_back();
+            throw;
+        }
+        return (*this)[size() - 1];
+    }
+
+    void pop_back() noexcept {
+        values.pop_back();
+        nexts.pop_back();
+    }
+
+    void clear() noexcept {
+        values.clear();
+        nexts.clear();
+    }
+
+    soa_node_ref<T, N> operator[](size_type i) noexcept {
+        return {values[i].value, nexts[i]};
+    }
+    soa_node_ref<const T, const N> operator[](size_type i) const noexcept {
+        return {values[i].value, nexts[i]};
+    }
+
+    template <typename... Args>
+    void construct(size_type i, Args&&... args) {
+        values[i].construct(std::forward<Args>(args)...);
+    }
+    void destroy(size_type i) noexcept {
+        values[i].destroy();
+    }
+
+    auto get_view() noexcept {
+        using VV = decltype(storage_view(values));
+        using NV = decltype(storage_view(nexts));
+        return view<VV, NV>{storage_view(values), storage_view(nexts)};
+    }
+    auto get_view() const noexcept {
+        using VV = decltype(storage_view(values));
+        using NV = decltype(storage_view(nexts));
+        return view<VV, NV>{storage_view(values), storage_view(nexts)};
+    }
+};
+
+template <typename T, typename N, typename S, typename A>
+auto storage_view(soa_nodes<T, N, S, A>& v) noexcept {
+    return v.get_view();
+}
+template <typename T, typename N, typename S, typename A>
+auto storage_view(const soa_nodes<T, N, S, A>& v) noexcept {
+    return v.get_view();
+}
+
+struct soa_layout {
+    template <typename T, typename N, typename Storage, typename A>
+    using nodes = soa_nodes<T, N, Storage, A>;
+
+    template <typename T, typename N>
+    static constexpr std::size_t node_size = sizeof(value_slot<T>) + sizeof(N);
+
+    template <typename Nodes, typename... Args>
+    static void construct(Nodes& n, std::size_t i, Args&&... args) {
+        n.construct(i, std::forward<Args>(args)...);
+    }
+    template <typename Nodes>
+    static void destroy(Nodes& n, std::size_t i) noexcept {
+        n.destroy(i);
+    }
+};
+
+#endif // POOL_LAYOUT_HPP
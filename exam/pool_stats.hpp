@@ -0,0 +1,107 @@
+#ifndef POOL_STATS_HPP
+#define POOL_STATS_HPP
+
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+
+/*
+ * Statistics policies for stack_pool.
+ *
+ * The pool calls the hooks of its Stats policy when a node is pushed,
+ * when the storage grows and when nodes go back to free_nodes.
+ * With no_stats, the default, the hooks are empty and inlined away,
+ * so a pool pays nothing for statistics it does not ask for.
+ * With pool_stats every hook updates a few counters, and the pool
+ * can be asked for a pool_counters snapshot in O(1).
+ */
+struct no_stats {
+    static constexpr bool enabled = false;
+
+    void on_push(bool, std::size_t, std::size_t = 1) noexcept {}
+    void on_grow() noexcept {}
+    void on_release(std::size_t) noexcept {}
+    void on_free_reset(std::size_t) noexcept {}
+};
+
+struct pool_stats {
+    static constexpr bool enabled = true;
+
+    std::size_t pushes{0};
+    std::size_t reuses{0};     // pushes that took a free node
+    std::size_t growths{0};    // pushes that made the storage grow
+    std::size_t pops{0};
+    std::size_t free_length{0};
+    std::size_t high_water{0}; // maximum number of live nodes
+
+    /*
+     * reused tells whether the n nodes came from free_nodes,
+     * live is the number of live nodes after the push.
+     */
+    void on_push(bool reused, std::size_t live, std::size_t n = 1) noexcept {
+        pushes += n;
+        if(reused){
+            reuses += n;
+            free_length -= n;
+        }
+        if(live > high_water)
+            high_water = live;
+    }
+    void on_grow() noexcept {
+        ++growths;
+    }
+    void on_release(std::size_t n) noexcept {
+        pops += n;
+        free_length += n;
+    }
+    void on_free_reset(std::size_t n) noexcept {
+        free_length = n;
+    }
+};
+
+/*
+ * A snapshot of the statistics of a pool, printed in the same
+ * tabular format of instrumented_base (see
+ * c++/10_efficient_programming/count_operations).
+ */
+struct pool_counters {
+    enum operations {
+        live,
+        free,
+        high_water,
+        pushes,
+        reuses,
+        growths,
+        pops,
+        bytes_reserved,
+        bytes_used
+    };
+
+    static constexpr std::size_t n_ops = 9;
+    std::size_t counts[n_ops];
+
+    std::size_t operator[](operations op) const noexcept {
+        return counts[op];
+    }
+
+    static void print_header() {
+        static const char* counter_names[n_ops] = {
+            "live",   "free",  "high water", "pushes",   "reuses",
+            "growths", "pops", "reserved B", "used B"};
+        const char s = ' ';
+        const int space = 12;
+        for(std::size_t i = 0; i < n_ops; ++i)
+            std::cout << std::setw(space) << counter_names[i] << s;
+        std::cout << std::endl;
+    }
+
+    void print_summary() const {
+        const char s = ' ';
+        const int space = 12;
+        for(std::size_t i = 0; i < n_ops; ++i)
+            std::cout << std::setw(space) << double(counts[i]) << s;
+        std::cout << std::endl;
+    }
+};
+
+#endif // POOL_STATS_HPP
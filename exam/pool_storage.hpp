@@ -0,0 +1,279 @@
+#ifndef POOL_STORAGE_HPP
+#define POOL_STORAGE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Storage policies for stack_pool.
+ *
+ * A storage policy tells the pool in which container the nodes are
+ * kept: policy::container<E, A> must behave like a std::vector<E, A>
+ * as far as size, capacity, reserve, emplace_back, pop_back, clear,
+ * operator[], get_allocator and the construction from an allocator
+ * are concerned. A is rebound to E by the policy.
+ *
+ * The iterators do not hold a reference to the container but a view
+ * of it, obtained through storage_view(container): something cheap to
+ * copy that supports operator[]. For a std::vector this is just the
+ * pointer to its first element.
+ */
+
+template <typename E, typename A>
+E* storage_view(std::vector<E, A>& v) noexcept {
+    return v.data();
+}
+template <typename E, typename A>
+const E* storage_view(const std::vector<E, A>& v) noexcept {
+    return v.data();
+}
+
+/*
+ * The pool calls store_free_head(container, head) whenever the head of
+ * its free nodes changes, so that a container can keep a copy of it
+ * (mapped_vector keeps it in the header of its file). Any other
+ * container ignores it.
+ */
+template <typename C, typename N>
+void store_free_head(C&, N) noexcept {}
+
+/*
+ * The default: a single contiguous buffer. Growing it moves every node.
+ */
+struct vector_storage {
+    template <typename E, typename A = std::allocator<E>>
+    using container = std::vector<E, typename std::allocator_traits<A>::template rebind_alloc<E>>;
+};
+
+/*
+ * A sequence of elements stored in chunks of 2^ChunkBits elements.
+ * The chunks never move, so growing is O(1) (apart from the
+ * directory of chunks, which holds just one pointer per chunk)
+ * and references to the elements are never invalidated by emplace_back.
+ *
+ * The element of index i lives in chunk i >> ChunkBits,
+ * at position i & (chunk_size - 1).
+ *
+ * Both the chunks and the directory are obtained from the allocator A,
+ * which follows the same propagation rules of the standard containers.
+ */
+template <typename E, std::size_t ChunkBits, typename A = std::allocator<E>>
+class chunked_vector {
+    using raw_type = std::aligned_storage_t<sizeof(E), alignof(E)>;
+    using alloc_traits = std::allocator_traits<A>;
+    using raw_alloc = typename alloc_traits::template rebind_alloc<raw_type>;
+    using raw_traits = std::allocator_traits<raw_alloc>;
+    using chunk_type = raw_type*;
+    using dir_alloc = typename alloc_traits::template rebind_alloc<chunk_type>;
+
+    static_assert(std::is_same<typename raw_traits::pointer, raw_type*>::value,
+                  "chunked_vector does not support fancy pointers");
+
+public:
+    using value_type = E;
+    using allocator_type = A;
+    using size_type = std::size_t;
+    static constexpr size_type chunk_size = size_type(1) << ChunkBits;
+    static constexpr size_type chunk_mask = chunk_size - 1;
+
+private:
+    raw_alloc alloc;
+    std::vector<chunk_type, dir_alloc> chunks;
+    size_type _size{0};
+
+    static E* at(const chunk_type* dir, size_type i) noexcept {
+        return std::launder(reinterpret_cast<E*>(&dir[i >> ChunkBits][i & chunk_mask]));
+    }
+
+    void add_chunk() {
+        auto c = raw_traits::allocate(alloc, chunk_size);
+        try {
+            chunks.push_back(c);
+        } catch(...) {
+            raw_traits::deallocate(alloc, c, chunk_size);
+            throw;
+        }
+    }
+
+    void release_chunks() noexcept {
+        for(auto c : chunks)
+            raw_traits::deallocate(alloc, c, chunk_size);
+        chunks.clear();
+    }
+
+    void steal(chunked_vector& o) noexcept {
+        chunks = std::move(o.chunks);
+        _size = o._size;
+        o.chunks.clear();
+        o._size = 0;
+    }
+
+public:
+    /*
+     * The view used by the iterators: the directory of chunks.
+     * It is invalidated when a new chunk is added, as the iterators
+     * of a std::vector are invalidated by a reallocation.
+     */
+    template <typename V>
+    class view {
+        const chunk_type* dir;
+    public:
+        explicit view(const chunk_type* d = nullptr) noexcept : dir{d} {};
+        V& operator[](size_type i) const noexcept {
+            return *at(dir, i);
+        }
+    };
+
+    chunked_vector() : chunked_vector{A{}} {}
+    explicit chunked_vector(const A& a) : alloc(a), chunks(dir_alloc(a)) {}
+
+    chunked_vector(const chunked_vector& o)
+        : chunked_vector{alloc_traits::select_on_container_copy_construction(o.get_allocator())} {
+        reserve(o._size);
+        for(size_type i = 0; i < o._size; ++i)
+            emplace_back(o[i]);
+    }
+    chunked_vector(chunked_vector&& o) noexcept
+        : alloc{std::move(o.alloc)}, chunks{std::move(o.chunks)}, _size{o._size} {
+        o.chunks.clear();
+        o._size = 0;
+    }
+
+    chunked_vector& operator=(const chunked_vector& o) {
+        if(this == &o)
+            return *this;
+        clear();
+        if constexpr(alloc_traits::propagate_on_container_copy_assignment::value){
+            if(alloc != o.alloc){
+                release_chunks();
+                chunks = std::vector<chunk_type, dir_alloc>(dir_alloc(o.alloc));
+            }
+            alloc = o.alloc;
+        }
+        reserve(o._size);
+        for(size_type i = 0; i < o._size; ++i)
+            emplace_back(o[i]);
+        return *this;
+    }
+
+    /*
+     * The chunks can be taken from o only if they can be given back
+     * to o's allocator through ours, otherwise the elements are moved
+     * one by one.
+     */
+    chunked_vector& operator=(chunked_vector&& o) noexcept(
+        alloc_traits::propagate_on_container_move_assignment::value ||
+        alloc_traits::is_always_equal::value) {
+        if(this == &o)
+            return *this;
+        clear();
+        if constexpr(alloc_traits::propagate_on_container_move_assignment::value){
+            release_chunks();
+            alloc = std::move(o.alloc);
+            steal(o);
+        } else {
+            if(alloc == o.alloc){
+                release_chunks();
+                steal(o);
+            } else {
+                reserve(o._size);
+                for(size_type i = 0; i < o._size; ++i)
+                    emplace_back(std::move(o[i]));
+                o.clear();
+            }
+        }
+        return *this;
+    }
+
+    ~chunked_vector() {
+        clear();
+        release_chunks();
+    }
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(alloc);
+    }
+
+    size_type size() const noexcept {
+        return _size;
+    }
+    size_type capacity() const noexcept {
+        return chunks.size() * chunk_size;
+    }
+    bool empty() const noexcept {
+        return _size == 0;
+    }
+
+    void reserve(size_type n) {
+        chunks.reserve((n + chunk_mask) >> ChunkBits);
+        while(capacity() < n)
+            add_chunk();
+    }
+
+    template <typename... Args>
+    E& emplace_back(Args&&... args) {
+        if(_size == capacity())
+            add_chunk();
+        E* p = reinterpret_cast<E*>(&chunks[_size >> ChunkBits][_size & chunk_mask]);
+        A a(alloc);
+        alloc_traits::construct(a, p, std::forward<Args>(args)...);
+        ++_size;
+        return *std::launder(p);
+    }
+
+    void pop_back() noexcept {
+        --_size;
+        A a(alloc);
+        alloc_traits::destroy(a, at(chunks.data(), _size));
+    }
+
+    /*
+     * The chunks are kept, as std::vector::clear keeps its buffer.
+     */
+    void clear() noexcept {
+        if constexpr(!std::is_trivially_destructible<E>::value)
+            while(_size) pop_back();
+        _size = 0;
+    }
+
+    E& operator[](size_type i) noexcept {
+        return *at(chunks.data(), i);
+    }
+    const E& operator[](size_type i) const noexcept {
+        return *at(chunks.data(), i);
+    }
+
+    view<E> get_view() noexcept {
+        return view<E>{chunks.data()};
+    }
+    view<const E> get_view() const noexcept {
+        return view<const E>{chunks.data()};
+    }
+};
+
+template <typename E, std::size_t B, typename A>
+auto storage_view(chunked_vector<E, B, A>& v) noexcept {
+    return v.get_view();
+}
+template <typename E, std::size_t B, typename A>
+auto storage_view(const chunked_vector<E, B, A>& v) noexcept {
+    return v.get_view();
+}
+
+/*
+ * Nodes stored in chunks of 2^ChunkBits: pushing never moves the
+ * existing nodes, so the latency of push is flat and the references
+ * returned by stack_pool::value stay valid.
+ */
+template <std::size_t ChunkBits = 10>
+struct chunked_storage {
+    template <typename E, typename A = std::allocator<E>>
+    using container = chunked_vector<E, ChunkBits,
+                                     typename std::allocator_traits<A>::template rebind_alloc<E>>;
+};
+
+#endif // POOL_STORAGE_HPP
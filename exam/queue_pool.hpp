@@ -0,0 +1,177 @@
+#ifndef QUEUE_POOL_HPP
+#define QUEUE_POOL_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+#include "stack_pool.hpp"
+
+/*
+ * A queue of a queue_pool: the addresses of its first and last node.
+ * The nodes go from front to back through their next.
+ */
+template <typename N>
+struct queue_handle {
+    N front{0};
+    N back{0};
+};
+
+/*
+ * A pool of FIFO queues, sibling of stack_pool.
+ *
+ * A queue is a singly linked list like a stack, read from the front,
+ * plus the address of its last node, so that push_back links a new
+ * node after it: push_back and pop_front are O(1), and the nodes are
+ * taken from and given back to the free nodes of the pool as for the
+ * stacks. Many short-lived queues share the same nodes, with no
+ * allocation once the pool has grown.
+ *
+ * The nodes are kept in a stack_pool: its iterators are the iterators
+ * of the queues, from front to back.
+ */
+template <typename T, typename N = std::size_t,
+          typename Storage = vector_storage, typename Layout = aos_layout>
+class queue_pool {
+    using pool_type = stack_pool<T, N, Storage, Layout>;
+    pool_type pool;
+
+    void check_logic_error(N x, const char* message) const {
+        if(pool.empty(x))
+            throw std::out_of_range(message);
+    }
+
+    /*
+     * See stack_pool::_stack
+     */
+    template <typename P>
+    class _queue {
+        P* pool_ptr;
+        queue_handle<N> q;
+    public:
+        _queue(P* ptr, const queue_handle<N>& x) noexcept
+            : pool_ptr{ptr}, q{x} {};
+        auto begin() const noexcept {
+            return pool_ptr->begin(q);
+        }
+        auto end() const noexcept {
+            return pool_ptr->end(q);
+        }
+    };
+
+public:
+    using stack_type = N;
+    using queue_type = queue_handle<N>;
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = typename pool_type::iterator;
+    using const_iterator = typename pool_type::const_iterator;
+
+    queue_pool() = default;
+
+    explicit queue_pool(size_type n) {
+        reserve(n);
+    }
+
+    void reserve(size_type n) {
+        pool.reserve(n);
+    }
+
+    size_type capacity() const noexcept {
+        return pool.capacity();
+    }
+
+    queue_type new_queue() const noexcept {
+        return {};
+    }
+
+    bool empty(const queue_type& q) const noexcept {
+        return pool.empty(q.front);
+    }
+
+    T& front(const queue_type& q) {
+        check_logic_error(q.front, "Requested front on empty queue");
+        return pool.value_unchecked(q.front);
+    }
+    const T& front(const queue_type& q) const {
+        check_logic_error(q.front, "Requested front on empty queue");
+        return pool.value_unchecked(q.front);
+    }
+
+    T& back(const queue_type& q) {
+        check_logic_error(q.back, "Requested back on empty queue");
+        return pool.value_unchecked(q.back);
+    }
+    const T& back(const queue_type& q) const {
+        check_logic_error(q.back, "Requested back on empty queue");
+        return pool.value_unchecked(q.back);
+    }
+
+    /*
+     * Each function returns the new queue, as stack_pool::push
+     * returns the new head.
+     */
+    queue_type push_back(const T& val, const queue_type& q) {
+        return emplace_back(q, val);
+    }
+    queue_type push_back(T&& val, const queue_type& q) {
+        return emplace_back(q, std::move(val));
+    }
+
+    template <typename... Args>
+    queue_type emplace_back(const queue_type& q, Args&&... args) {
+        auto x = pool.emplace(pool.end(), std::forward<Args>(args)...);
+        if(empty(q))
+            return {x, x};
+        pool.next_unchecked(q.back) = x;
+        return {q.front, x};
+    }
+
+    /*
+     * It throws std::out_of_range if the queue is empty.
+     */
+    queue_type pop_front(const queue_type& q) {
+        check_logic_error(q.front, "Requested pop_front on empty queue");
+        auto x = pool.pop_unchecked(q.front);
+        return {x, pool.empty(x) ? x : q.back};
+    }
+
+    /*
+     * All the nodes go back to the free nodes with a single relink,
+     * in O(1) if T is trivially destructible.
+     */
+    queue_type free_queue(const queue_type& q) noexcept {
+        pool.free_stack(q.front, q.back);
+        return {};
+    }
+
+    iterator begin(const queue_type& q) noexcept {
+        return pool.begin(q.front);
+    }
+    iterator end(const queue_type& q) noexcept {
+        return pool.end(q.front);
+    }
+
+    const_iterator begin(const queue_type& q) const noexcept {
+        return pool.cbegin(q.front);
+    }
+    const_iterator end(const queue_type& q) const noexcept {
+        return pool.cend(q.front);
+    }
+
+    const_iterator cbegin(const queue_type& q) const noexcept {
+        return pool.cbegin(q.front);
+    }
+    const_iterator cend(const queue_type& q) const noexcept {
+        return pool.cend(q.front);
+    }
+
+    auto queue(const queue_type& q) noexcept {
+        return _queue<queue_pool>{this, q};
+    }
+    auto queue(const queue_type& q) const noexcept {
+        return _queue<const queue_pool>{this, q};
+    }
+};
+
+#endif // QUEUE_POOL_HPP
@@ -0,0 +1,116 @@
+#include "catch.hpp"
+
+#include "queue_pool.hpp"
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+SCENARIO("FIFO queues in a pool"){
+  GIVEN("a queue with some values"){
+    queue_pool<int, std::uint16_t> pool;
+    auto q = pool.new_queue();
+    REQUIRE(pool.empty(q));
+    for(int i = 1; i <= 5; ++i)
+      q = pool.push_back(i, q);
+
+    THEN("they come out in the order they went in"){
+      REQUIRE(pool.front(q) == 1);
+      REQUIRE(pool.back(q) == 5);
+      std::vector<int> v(pool.begin(q), pool.end(q));
+      REQUIRE(v == std::vector<int>{1, 2, 3, 4, 5});
+      int sum = 0;
+      for(auto x : pool.queue(q))
+        sum += x;
+      REQUIRE(sum == 15);
+    }
+
+    WHEN("it is popped to the end"){
+      for(int i = 1; i <= 5; ++i){
+        REQUIRE(pool.front(q) == i);
+        q = pool.pop_front(q);
+      }
+
+      THEN("it is empty and its nodes are reused"){
+        REQUIRE(pool.empty(q));
+        REQUIRE_THROWS_AS(pool.pop_front(q), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.front(q), std::out_of_range);
+        for(int i = 0; i < 5; ++i)
+          q = pool.push_back(i, q);
+        REQUIRE(pool.capacity() < 10);
+        REQUIRE(std::accumulate(pool.begin(q), pool.end(q), 0) == 10);
+      }
+    }
+
+    WHEN("pushes and pops are interleaved"){
+      q = pool.pop_front(q);
+      q = pool.push_back(6, q);
+      q = pool.pop_front(q);
+
+      THEN("front and back move independently"){
+        REQUIRE(pool.front(q) == 3);
+        REQUIRE(pool.back(q) == 6);
+        std::vector<int> v(pool.cbegin(q), pool.cend(q));
+        REQUIRE(v == std::vector<int>{3, 4, 5, 6});
+      }
+    }
+
+    WHEN("the queue is freed"){
+      q = pool.free_queue(q);
+      auto r = pool.push_back(7, pool.new_queue());
+
+      THEN("its nodes go back to the pool"){
+        REQUIRE(pool.empty(q));
+        REQUIRE(pool.front(r) == 7);
+        REQUIRE(pool.front(r) == pool.back(r));
+      }
+    }
+  }
+
+  GIVEN("many queues sharing the pool"){
+    queue_pool<std::string> pool;
+    std::vector<queue_pool<std::string>::queue_type> qs(3, pool.new_queue());
+    for(int i = 0; i < 9; ++i)
+      qs[i % 3] = pool.push_back(std::to_string(i), qs[i % 3]);
+
+    THEN("each queue keeps its own order"){
+      std::string s;
+      for(auto& x : pool.queue(qs[1]))
+        s += x;
+      REQUIRE(s == "147");
+      REQUIRE(pool.back(qs[2]) == "8");
+    }
+
+    WHEN("a queue is drained and another grows"){
+      while(!pool.empty(qs[0]))
+        qs[0] = pool.pop_front(qs[0]);
+      for(int i = 0; i < 3; ++i)
+        qs[2] = pool.emplace_back(qs[2], 2, 'x');
+
+      THEN("the nodes are recycled"){
+        REQUIRE(pool.capacity() >= 9);
+        std::string s;
+        for(auto& x : pool.queue(qs[2]))
+          s += x;
+        REQUIRE(s == "258xxxxxx");
+      }
+    }
+  }
+
+  GIVEN("a queue of move-only values"){
+    queue_pool<std::unique_ptr<int>> pool;
+    auto q = pool.new_queue();
+    q = pool.push_back(std::make_unique<int>(1), q);
+    q = pool.emplace_back(q, new int{2});
+
+    THEN("they are moved in and destroyed when popped"){
+      REQUIRE(*pool.front(q) == 1);
+      q = pool.pop_front(q);
+      REQUIRE(*pool.front(q) == 2);
+      q = pool.free_queue(q);
+      REQUIRE(pool.empty(q));
+    }
+  }
+}
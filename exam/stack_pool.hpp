@@ -1,13 +1,39 @@
+#ifndef STACK_POOL_HPP
+#define STACK_POOL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "../c++/06_error_handling/ap_error.hpp"
+#include "pool_free_list.hpp"
+#include "pool_layout.hpp"
+#include "pool_stats.hpp"
+#include "pool_storage.hpp"
+
 /*
- * Without exposing the underlying representation
+ * Without exposing the underlying representation.
+ *
+ * The iterator holds a view of the nodes, i.e. anything that gives
+ * the node stored at a given index through operator[] (a plain
+ * pointer for nodes stored in a std::vector), and the address
+ * of the current node.
  */
-template <typename node_t, typename T, typename N>
+template <typename nodes_t, typename T, typename N>
 class _iterator {
-    node_t* first_pool_node_ptr; 
-    node_t* current_node_ptr;
+    nodes_t nodes;
+    N current;
 public: 
     using value_type = T;
     using pointer = value_type*;
@@ -19,39 +45,101 @@ public:
     using difference_type = std::ptrdiff_t;
     typedef std::forward_iterator_tag iterator_category; 
     
-    _iterator(stack_type x, node_t* ptr) noexcept :
-        first_pool_node_ptr{ptr}, current_node_ptr{first_pool_node_ptr + x - 1} {};
+    constexpr _iterator(stack_type x, nodes_t n) noexcept :
+        nodes{n}, current{x} {};
         
-    reference operator*() const {
-        return current_node_ptr->value;
+    constexpr reference operator*() const {
+        return nodes[current - 1].value;
     }
-    _iterator& operator++() {
-        current_node_ptr = first_pool_node_ptr + current_node_ptr->next - 1;
+    constexpr _iterator& operator++() {
+        current = nodes[current - 1].next;
         return *this;
     }
-    _iterator operator++(int){ 
+    constexpr _iterator operator++(int){ 
         auto tmp = *this;
         ++(*this);
         return tmp;
     }
-    friend bool operator==(const _iterator& it_a, const _iterator& it_b) noexcept {
-        return it_a.current_node_ptr == it_b.current_node_ptr;
+    friend constexpr bool operator==(const _iterator& it_a, const _iterator& it_b) noexcept {
+        return it_a.current == it_b.current;
     }
-    friend bool operator!=(const _iterator& it_a, const _iterator& it_b) noexcept {
+    friend constexpr bool operator!=(const _iterator& it_a, const _iterator& it_b) noexcept {
         return !(it_a == it_b);
     }
 };
 
-template <typename T, typename N = std::size_t>
-class stack_pool {
-    
-    struct node_t {
-        T value;
-        N next;
-        template <typename O>
-            node_t(O&& o, N n)
-            : value{std::forward<O>(o)}, next{n} {}; 
-    };
+/*
+ * The narrowest unsigned type that can address MaxIndex nodes
+ * (the address of a node is its index plus one, 0 being end).
+ */
+template <std::size_t MaxIndex>
+using smallest_index_t =
+    std::conditional_t<MaxIndex <= UINT8_MAX, std::uint8_t,
+    std::conditional_t<MaxIndex <= UINT16_MAX, std::uint16_t,
+    std::conditional_t<MaxIndex <= UINT32_MAX, std::uint32_t, std::uint64_t>>>;
+
+/*
+ * The header of a snapshot written by stack_pool::save.
+ * format tells how the nodes follow it: raw, i.e. node_size bytes
+ * per node as they are in memory, or serialized, i.e. for every node
+ * its next, a byte telling whether it is live and, if it is, its value
+ * as written by the serializer of the user.
+ */
+struct snapshot_header {
+    enum : std::uint32_t { raw = 0, serialized = 1 };
+    static constexpr char stkpool_magic[8] = {'s', 't', 'k', 's', 'n', 'a', 'p', '\0'};
+    static constexpr std::uint32_t current_version = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t format;
+    std::uint32_t node_size;
+    std::uint32_t index_width;
+    std::uint64_t size;
+    std::uint64_t free_nodes;
+};
+
+/*
+ * A stack together with its size and its last node, so that
+ * stack_pool can tell the size, give the bottom value and append a
+ * stack to another in O(1).
+ * It is kept up to date by the overloads of stack_pool taking it;
+ * the functions taking the bare head do not know about it, so a
+ * handle must not be used after its nodes are changed through them.
+ */
+template <typename N>
+struct stack_handle {
+    N head{0};
+    std::size_t size{0};
+    N tail{0};
+};
+
+/*
+ * Storage selects the container of the nodes (see pool_storage.hpp):
+ * vector_storage, the default, keeps them in a std::vector,
+ * chunked_storage<> in fixed-size chunks that never move.
+ *
+ * Layout selects how value and next are placed (see pool_layout.hpp):
+ * aos_layout, the default, keeps them together in a node_t,
+ * soa_layout keeps all the values and all the nexts in two arrays.
+ *
+ * Allocator is rebound and handed to the containers of the storage,
+ * which propagate it on copy and move as the standard containers do.
+ *
+ * Stats selects the statistics kept by the pool (see pool_stats.hpp):
+ * no_stats, the default, keeps none and costs nothing,
+ * pool_stats counts pushes, reuses, growths and pops, see stats().
+ *
+ * FreeList selects which free node a push takes (see pool_free_list.hpp):
+ * lifo_free_list, the default, the last one popped,
+ * ordered_free_list the lowest one, near_head_free_list one close to
+ * the head of the stack, to keep the nodes of a stack together.
+ */
+template <typename T, typename N = std::size_t,
+          typename Storage = vector_storage, typename Layout = aos_layout,
+          typename Allocator = std::allocator<T>, typename Stats = no_stats,
+          typename FreeList = lifo_free_list>
+class stack_pool : private Stats, private FreeList { // bases, so that empty policies take no space
 
     /*
      * This class allows stack_pool to have begin() and end() public methods.
@@ -79,40 +167,195 @@ class stack_pool {
         }    
     };
 
-    std::vector<node_t> pool;
+protected:
+    /*
+     * The nodes and the head of the free nodes are protected, so that
+     * a derived pool can restore them (see mapped_stack_pool).
+     */
+    using container_type = typename Layout::template nodes<T, N, Storage, Allocator>;
+    container_type pool;
     using stack_type = N;
     using value_type = T;
-    using size_type = typename std::vector<node_t>::size_type;
+    using size_type = typename container_type::size_type;
+    using nodes_view = decltype(storage_view(std::declval<container_type&>()));
+    using const_nodes_view = decltype(storage_view(std::declval<const container_type&>()));
     stack_type free_nodes{end()};
 
+private:
+    /*
+     * While a mark is active, every free node that is reused is
+     * recorded with the next it had, so that rollback can put it
+     * back in the free nodes (see mark()).
+     */
+    using journal_entry = std::pair<stack_type, stack_type>;
+    using journal_alloc =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<journal_entry>;
+    std::vector<journal_entry, journal_alloc> journal;
+    std::size_t marks{0};
+    // the size, the journal and the id of the innermost active mark
+    size_type marked_size{0};
+    std::size_t marked_journal{0};
+    std::size_t marked_id{0};
+    std::size_t mark_serial{0}; // the id of the last mark taken
+
     /*
      * Functions that defines a one-to-one correspondence between
      * a particular stack and the vector it is stored in.
+     * With soa_layout the node is not an object in memory, so what
+     * is returned is a pair of references to its value and its next.
      */
-    node_t& node(stack_type x) noexcept {
+    decltype(auto) node(stack_type x) noexcept {
         return pool[x - 1]; 
     }
-    const node_t& node(stack_type x) const noexcept { 
+    decltype(auto) node(stack_type x) const noexcept { 
         return pool[x - 1]; 
     }
 
+    Stats& counters() noexcept {
+        return *this;
+    }
+    const Stats& counters() const noexcept {
+        return *this;
+    }
+
+    /*
+     * With lifo_free_list the free nodes are the chain of free_nodes,
+     * otherwise they are kept by the policy.
+     */
+    FreeList& free_list() noexcept {
+        return *this;
+    }
+    bool has_free_nodes() const noexcept {
+        if constexpr(FreeList::chained)
+            return !empty(free_nodes);
+        else
+            return FreeList::has_free();
+    }
+
+    /*
+     * Every change of the head of the free nodes goes through here,
+     * so that a container that keeps it too (mapped_vector, in the
+     * header of its file) is always up to date.
+     */
+    void set_free_nodes(stack_type x) noexcept {
+        free_nodes = x;
+        store_free_head(pool, x);
+    }
+
     /*
      * Forwarding referenced in order to have a push method that is
      * able to accept both const& value and rvalue without
      * code-duplication of the body function.
+     * The arguments are forwarded to the constructor of T, so the
+     * same function serves push and emplace.
+     */
+    template <typename... Args>
+        stack_type _push(stack_type head, Args&&... args);
+
+    /*
+     * Puts the chain of nodes that goes from first to last (included)
+     * on top of free_nodes, destroying their values.
+     * Returns the node that followed last.
+     */
+    stack_type release(stack_type first, stack_type last) noexcept;
+
+    /*
+     * Appends a new node to the storage, telling the statistics
+     * whether the storage had to grow.
+     */
+    template <typename... Args>
+        stack_type append(stack_type head, Args&&... args);
+
+    /*
+     * The free-node phase of push_range: pushes elements from first
+     * on the free nodes onto the stack x, advancing first, x and n
+     * at every node, until either runs out.
      */
-    template <typename O>
-        stack_type _push(O&& val, stack_type head);
+    template <typename I>
+        void push_free(I& first, I last, stack_type& x, size_type& n);
+
+    /*
+     * push_range, telling also how many nodes were pushed and which
+     * one is the lowest of them, so that a handle needs no walk.
+     */
+    template <typename I>
+        stack_type push_counted(I first, I last, stack_type head, size_type& n, stack_type& bottom);
+
+    /*
+     * Links the stacks in pieces into the single stack of h, one of
+     * their nodes: what merge and sort leave if the comparison throws.
+     */
+    template <std::size_t K>
+        void relink(stack_type h, const stack_type (&pieces)[K]) noexcept;
+
+    /*
+     * Helpers of save and load.
+     */
+    snapshot_header make_header(std::uint32_t format) const noexcept;
+    snapshot_header read_header(std::istream& is, std::uint32_t format) const;
+    void adopt(container_type&& loaded, stack_type free);
 
     /*
      * This function is used to perform checkings for logic errors
      * eventually committed by the user, e.g. popping an empty stack.
      */
-    void check_logic_error(stack_type x, const std::string& message) const {
+    void check_logic_error(stack_type x, const char* message) const {
         if(empty(x)) 
             throw std::out_of_range(message);
     }
 
+    /*
+     * The same checks for the unchecked tier: they are assertions,
+     * so they vanish when compiling with -DNDEBUG.
+     */
+    void assert_node(stack_type x) const {
+        AP_ASSERT(!empty(x) && x <= pool.size(), std::out_of_range)
+            << "Requested node " << +x << " of a pool of " << pool.size() << " nodes\n";
+    }
+
+public:
+    // whether AP_ASSERT checks anything: the noexcept of some functions depends on it
+#ifdef NDEBUG
+    static constexpr bool debug_checks = false;
+#else
+    static constexpr bool debug_checks = true;
+#endif
+
+private:
+    // rollback and commit accept only the innermost active mark
+    void check_mark(std::size_t id, const char* message) const {
+        if(!marks || id != marked_id)
+            throw std::out_of_range(message);
+    }
+
+    /*
+     * A node that was live at the innermost mark must not be freed or
+     * relinked before the mark is gone: rollback would bring it back
+     * with its value destroyed. Such a node comes before the mark and
+     * was not taken from the free nodes after it. In debug builds pop,
+     * pop_n, free_stack and concat check it (through AP_ASSERT, which
+     * throws std::logic_error), so free_stack and concat are noexcept
+     * only with -DNDEBUG. While a mark is active each check scans the
+     * journal of the mark: free_stack costs O(length * journal).
+     */
+    bool live_at_mark(stack_type x) const noexcept {
+        if(!marks || x > marked_size)
+            return false;
+        return std::none_of(journal.begin() + marked_journal, journal.end(),
+                            [x](const journal_entry& e){ return e.first == x; });
+    }
+    void assert_unmarked(stack_type x) const {
+        AP_ASSERT(!live_at_mark(x), std::logic_error)
+            << "Node " << +x << " was live at the mark: it cannot change before the rollback\n";
+    }
+    void assert_unmarked(stack_type first, stack_type last) const {
+        if(!marks)
+            return;
+        for(auto x = first; x != last; x = node(x).next)
+            assert_unmarked(x);
+        assert_unmarked(last);
+    }
+
 public:
     /*
      * Default constructor that construct a new instance of
@@ -130,6 +373,23 @@ public:
     explicit stack_pool(size_type n) {
         reserve(n);
     }
+
+    /*
+     * The same two constructors, with the allocator
+     * to be used for the nodes.
+     */
+    explicit stack_pool(const Allocator& alloc)
+        : pool(alloc), journal(journal_alloc(alloc)) {}
+    stack_pool(size_type n, const Allocator& alloc)
+        : pool(alloc), journal(journal_alloc(alloc)) {
+        reserve(n);
+    }
+
+    using allocator_type = Allocator;
+
+    allocator_type get_allocator() const noexcept {
+        return allocator_type(pool.get_allocator());
+    }
     
     /*
      * This method creates a new empty stack,
@@ -140,16 +400,16 @@ public:
     }
     
     /*
-     * stack_pool::reserve calls the vector::reserve method.
+     * stack_pool::reserve calls the reserve method of the container.
      * It throws if the given argument n exceeds the maximum number 
-     * of elements the container std::vector is able to hold.
+     * of elements the container is able to hold.
      */
     void reserve(size_type n) { 
         pool.reserve(n);
     }
     
     /*
-     * Returns the current capacity of the std::vector pool
+     * Returns the current capacity of the pool
      */
     size_type capacity() const noexcept {
         return pool.capacity();
@@ -207,28 +467,204 @@ public:
         return node(x).next;
     }
 
+    /*
+     * The unchecked tier: value, next and pop without the check on
+     * an empty stack, for the tight loops whose caller already knows
+     * that x is a node (e.g. because it is not end()).
+     * In debug builds the check is still made by AP_ASSERT, which
+     * throws std::out_of_range; with -DNDEBUG nothing is checked and
+     * passing end() or an invalid index is undefined behaviour.
+     * The check is a branch never taken: walking a stack it is hidden
+     * by the latency of the next node, and only reads that do not
+     * depend on each other get faster (see bench_unchecked).
+     */
+    T& value_unchecked(stack_type x) {
+        assert_node(x);
+        return node(x).value;
+    }
+    const T& value_unchecked(stack_type x) const {
+        assert_node(x);
+        return node(x).value;
+    }
+
+    stack_type& next_unchecked(stack_type x) {
+        assert_node(x);
+        return node(x).next;
+    }
+    const stack_type& next_unchecked(stack_type x) const {
+        assert_node(x);
+        return node(x).next;
+    }
+
+    stack_type pop_unchecked(stack_type x);
+
     stack_type push(const T& val, stack_type head) {
-        return _push(val, head);
+        return _push(head, val);
     }
     stack_type push(T&& val, stack_type head){
-        return _push(std::move(val), head);
+        return _push(head, std::move(val));
+    }
+
+    /*
+     * Constructs the new value directly in the node,
+     * no temporary T is created.
+     */
+    template <typename... Args>
+    stack_type emplace(stack_type head, Args&&... args) {
+        return _push(head, std::forward<Args>(args)...);
     }
 
     stack_type pop(stack_type x);
 
+    /*
+     * Pops the first k nodes of the stack x in one go: their values
+     * are destroyed and the whole chain is put on top of free_nodes
+     * with a single relink.
+     * It throws std::out_of_range, leaving the stack untouched,
+     * if the stack has less than k nodes.
+     */
+    stack_type pop_n(stack_type x, size_type k);
+
+    /*
+     * Pushes the elements of [first, last) on the stack head, in order,
+     * so the last one ends up on top (as if push were called on each).
+     * The free nodes are used first, then the remaining elements are
+     * appended after a single reserve (if the distance of the range
+     * can be computed), so that consecutive elements sit in
+     * consecutive nodes.
+     * If a constructor throws, the nodes pushed so far are popped
+     * and the exception is rethrown.
+     */
+    template <typename I>
+    stack_type push_range(I first, I last, stack_type head);
+
     /*
      * stack_type::free_stack takes a given stack
-     * and, by popping all of it's nodes, returns an empty stack
+     * and returns an empty stack: all of it's nodes are moved
+     * to free_nodes with a single relink, after walking the stack
+     * to find its last node (and to destroy the values, if needed).
      * We can say that the stack is now freed.
      *
-     * This method cannot throw exceptions because pop is
-     * proteced by the control in the while loop.
+     * This method cannot throw exceptions, apart from the checks of
+     * the debug builds on the marks (see mark()).
      * Still, the user should be careful and be sure to pass 
      * the head of the stack as argument.
      */
-    stack_type free_stack(stack_type x) noexcept { 
-        while(x) x = pop(x);
-        return x;
+    stack_type free_stack(stack_type x) noexcept(!debug_checks) { 
+        if(empty(x))
+            return x;
+        auto tail = x;
+        assert_unmarked(x);
+        while(node(tail).next){
+            tail = node(tail).next;
+            assert_unmarked(tail);
+        }
+        return release(x, tail);
+    }
+
+    /*
+     * Same as above, for a caller that already knows the last node
+     * of the stack: if T is trivially destructible it is O(1).
+     */
+    stack_type free_stack(stack_type x, stack_type tail) noexcept(!debug_checks) {
+        if(empty(x))
+            return x;
+        assert_unmarked(x, tail);
+        return release(x, tail);
+    }
+
+    /*
+     * The same operations on a stack_handle, which keeps the size
+     * and the last node of the stack up to date. Each one returns
+     * the new handle, as the functions above return the new head.
+     */
+    using handle_type = stack_handle<N>;
+
+    handle_type new_handle() const noexcept {
+        return {};
+    }
+
+    /*
+     * The handle of an existing stack: it walks the stack once.
+     */
+    handle_type make_handle(stack_type x) const noexcept {
+        handle_type h{x, 0, x};
+        for(; x; x = node(x).next, ++h.size)
+            h.tail = x;
+        return h;
+    }
+
+    bool empty(const handle_type& h) const noexcept {
+        return empty(h.head);
+    }
+    size_type size(const handle_type& h) const noexcept {
+        return h.size;
+    }
+
+    T& value(const handle_type& h) {
+        return value(h.head);
+    }
+    const T& value(const handle_type& h) const {
+        return value(h.head);
+    }
+
+    /*
+     * The value at the bottom of the stack.
+     */
+    T& back(const handle_type& h) {
+        check_logic_error(h.tail, "Requested back on empty stack");
+        return node(h.tail).value;
+    }
+    const T& back(const handle_type& h) const {
+        check_logic_error(h.tail, "Requested back on empty stack");
+        return node(h.tail).value;
+    }
+
+    handle_type push(const T& val, const handle_type& h) {
+        return emplace(h, val);
+    }
+    handle_type push(T&& val, const handle_type& h) {
+        return emplace(h, std::move(val));
+    }
+
+    template <typename... Args>
+    handle_type emplace(const handle_type& h, Args&&... args) {
+        auto x = _push(h.head, std::forward<Args>(args)...);
+        return {x, h.size + 1, empty(h) ? x : h.tail};
+    }
+
+    handle_type pop(const handle_type& h) {
+        auto x = pop(h.head);
+        return {x, h.size - 1, empty(x) ? x : h.tail};
+    }
+
+    handle_type pop_n(const handle_type& h, size_type k) {
+        auto x = pop_n(h.head, k);
+        return {x, h.size - k, empty(x) ? x : h.tail};
+    }
+
+    template <typename I>
+    handle_type push_range(I first, I last, const handle_type& h);
+
+    /*
+     * O(1), if T is trivially destructible.
+     */
+    handle_type free_stack(const handle_type& h) noexcept(!debug_checks) {
+        free_stack(h.head, h.tail);
+        return {};
+    }
+
+    /*
+     * Puts the stack b below the stack a in O(1): the result is
+     * a stack that is traversed as a and then as b. Both a and b
+     * are consumed.
+     */
+    handle_type concat(const handle_type& a, const handle_type& b) noexcept(!debug_checks) {
+        if(empty(a))
+            return b;
+        assert_unmarked(a.tail);
+        node(a.tail).next = b.head;
+        return {a.head, a.size + b.size, empty(b) ? a.tail : b.tail};
     }
 
     /*
@@ -238,33 +674,219 @@ public:
     auto stack(stack_type head) noexcept{
         return _stack{this, head}; // call ctor of _stack class
     }
+    auto stack(const handle_type& h) noexcept{
+        return _stack{this, h.head};
+    }
 
     void display_stack(stack_type x) const;
 
+    /*
+     * Writes a binary snapshot of the whole pool: a snapshot_header,
+     * then the nodes. For trivially copyable T the nodes are written
+     * as they are in memory, in a single write if they are contiguous
+     * and have no padding.
+     * The addresses are kept, so the stacks of the caller are valid
+     * in the pool loaded from the snapshot.
+     * It throws std::runtime_error if the stream fails.
+     */
+    void save(std::ostream& os) const;
+
+    /*
+     * Replaces the content of the pool with the snapshot read from is,
+     * which must have been saved by a pool with the same T and N.
+     * The nodes are read in large blocks and appended to the storage:
+     * no push, no allocation per node.
+     * It throws std::runtime_error if the stream fails or does not
+     * hold a suitable snapshot; then the pool is left untouched.
+     * It invalidates all the iterators, references and marks.
+     */
+    void load(std::istream& is);
+
+    /*
+     * The same for any T, through a serializer of the user:
+     * write(os, value) must write a value, read(is) must read it back
+     * and return it. The free nodes have no value: on load they are
+     * built with the default constructor of T, then emptied.
+     */
+    template <typename Write>
+    void save(std::ostream& os, Write write) const;
+    template <typename Read>
+    void load(std::istream& is, Read read);
+
+    /*
+     * A checkpoint of the pool, to go back to with rollback.
+     */
+    struct mark_type {
+        size_type size;
+        stack_type free_nodes;
+        std::size_t journal;
+        std::size_t free_count; // for the statistics, if any
+        std::size_t id;
+        size_type outer_size;   // of the enclosing mark, if any
+        std::size_t outer_journal;
+        std::size_t outer_id;
+    };
+
+    /*
+     * Takes a checkpoint in O(1). Until it is rolled back or
+     * committed, the pool works as a scratch arena:
+     * rollback(m) throws away every node pushed after the mark,
+     * destroying their values, in O(nodes pushed since the mark),
+     * and the heads that the caller had at the mark are valid again.
+     *
+     * Rollback can restore only what the mark recorded: the number
+     * of nodes and the free nodes. The nodes that were live at the
+     * mark must not be changed (by pop, free_stack, concat, sort...)
+     * nor the pool compacted before the rollback: in debug builds
+     * pop, pop_n, free_stack and concat check it, throwing
+     * std::logic_error and leaving the stacks untouched.
+     * Marks can be nested, and rolled back or committed in LIFO order:
+     * only the innermost active mark is accepted.
+     */
+    mark_type mark() noexcept {
+        static_assert(FreeList::chained, "mark needs lifo_free_list");
+        ++marks;
+        mark_type m{pool.size(), free_nodes, journal.size(), 0, ++mark_serial,
+                    marked_size, marked_journal, marked_id};
+        marked_size = pool.size();
+        marked_journal = journal.size();
+        marked_id = m.id;
+        if constexpr(Stats::enabled)
+            m.free_count = counters().free_length;
+        return m;
+    }
+
+    /*
+     * It throws std::out_of_range if m is not the innermost active
+     * mark (an outer one, or one already rolled back or committed).
+     */
+    void rollback(const mark_type& m);
+
+    /*
+     * Keeps what was done since the mark m; it throws
+     * std::out_of_range as rollback does.
+     */
+    void commit(const mark_type& m) {
+        check_mark(m.id, "Requested commit of a mark that is not the innermost active one");
+        marked_size = m.outer_size;
+        marked_journal = m.outer_journal;
+        marked_id = m.outer_id;
+        if(!--marks)
+            journal.clear();
+    }
+
+    /*
+     * Algorithms that reorder the nodes of a stack by changing only
+     * their next: no value is copied, moved or swapped, so the cost
+     * does not depend on the size of T. They return the new head,
+     * the nodes (and the references to their values) stay the same.
+     */
+    stack_type reverse(stack_type x) noexcept;
+
+    /*
+     * Merges the sorted stacks a and b into a single sorted stack.
+     * It is stable: of two equivalent values, the one of a comes first.
+     * If cmp throws, all the nodes of a and b are left in the stack
+     * of a, in no particular order, and the exception is rethrown.
+     */
+    template <typename Compare = std::less<>>
+    stack_type merge(stack_type a, stack_type b, Compare cmp = Compare{});
+
+    /*
+     * Stable bottom-up merge sort: runs of 1, 2, 4, ... nodes are
+     * merged as they are formed, keeping at most one run per size,
+     * so it takes O(n log n) comparisons and no memory besides one
+     * head per bit of N.
+     * If cmp throws, all the nodes are left in the stack of x, in no
+     * particular order, and the exception is rethrown.
+     */
+    template <typename Compare = std::less<>>
+    stack_type sort(stack_type x, Compare cmp = Compare{});
+
+    handle_type reverse(const handle_type& h) noexcept {
+        return {reverse(h.head), h.size, h.head};
+    }
+    template <typename Compare = std::less<>>
+    handle_type merge(const handle_type& a, const handle_type& b, Compare cmp = Compare{}) {
+        if(empty(a))
+            return b;
+        if(empty(b))
+            return a;
+        // the node that comes last is the greatest of the two tails
+        auto tail = cmp(node(b.tail).value, node(a.tail).value) ? a.tail : b.tail;
+        return {merge(a.head, b.head, cmp), a.size + b.size, tail};
+    }
+    template <typename Compare = std::less<>>
+    handle_type sort(const handle_type& h, Compare cmp = Compare{}) {
+        return make_handle(sort(h.head, cmp));
+    }
+
+    /*
+     * Renumbers the live nodes so that every stack is stored in
+     * consecutive nodes, in the order in which it is traversed,
+     * and drops the free nodes: afterwards free_nodes is empty and
+     * the capacity is exactly the number of live nodes.
+     *
+     * The stacks are found as the live nodes that are not the next
+     * of any other live node. Returns the table to translate the
+     * stacks held by the caller: the new address of x is table[x]
+     * (and table[end()] == end()).
+     *
+     * It costs O(n) time and the memory of a second copy of the nodes,
+     * and it invalidates all the iterators, references and marks.
+     * If an exception is thrown, the pool is left untouched.
+     */
+    std::vector<stack_type> compact();
+
+    /*
+     * Gives back to the free nodes every node that cannot be reached
+     * from the stacks in roots, e.g. the nodes of a stack whose head
+     * was lost, and returns how many nodes were reclaimed.
+     *
+     * The reachable nodes are marked in a bitmap, then a single sweep
+     * over the pool destroys the values of the unreachable ones and
+     * links all of them, together with the nodes that were already
+     * free, in a new list of free nodes sorted by address.
+     * It takes O(size of the pool) time and one bitmap of memory, and
+     * it invalidates the marks (see mark()). Every stack still in use
+     * must be in roots, otherwise its nodes will be reused.
+     */
+    template <typename R>
+    size_type collect(const R& roots);
+    size_type collect(std::initializer_list<stack_type> roots) {
+        return collect<std::initializer_list<stack_type>>(roots);
+    }
+
+    /*
+     * A snapshot of the statistics of the pool, in O(1).
+     * Available only if the pool keeps them (Stats = pool_stats).
+     */
+    pool_counters stats() const noexcept;
+
 public:
-    using iterator = _iterator<node_t, T, N>;
-    using const_iterator = _iterator<node_t, const T, N>;
+    using iterator = _iterator<nodes_view, T, N>;
+    using const_iterator = _iterator<const_nodes_view, const T, N>;
 
     iterator begin(stack_type x) noexcept {
-        return iterator{x, pool.data()}; // calls ctor defined in class _iterator
+        return iterator{x, storage_view(pool)}; // calls ctor defined in class _iterator
                                          // returns the begin of the stack
     }
     iterator end(stack_type ) noexcept { 
-        return iterator{0, pool.data()}; // returns the end of the stack
+        return iterator{0, storage_view(pool)}; // returns the end of the stack
     }
 
     const_iterator begin(stack_type x) const noexcept {
-        return const_iterator{x, pool.data()};
+        return const_iterator{x, storage_view(pool)};
     }
     const_iterator end(stack_type ) const noexcept {
-        return const_iterator{0, pool.data()};
+        return const_iterator{0, storage_view(pool)};
     }
 
     const_iterator cbegin(stack_type x) const noexcept {
-        return const_iterator{x, pool.data()};
+        return const_iterator{x, storage_view(pool)};
     }
     const_iterator cend(stack_type ) const noexcept{
-        return const_iterator{0, pool.data()};
+        return const_iterator{0, storage_view(pool)};
     }
 };
 
@@ -284,24 +906,76 @@ public:
  * If the memory needed exceed the memory the container is able to hold,
  * it has to throw. 
  *
+ * The address of the new node must fit in N: when the pool already
+ * has as many nodes as N can address, it throws std::length_error
+ * instead of silently wrapping the address around.
+ *
  * Also, it constructs the object of type T,
  * and this class may have a throwing ctor.
+ * When a free node is reused, T is constructed in its (empty) slot
+ * before touching free_nodes: if the ctor throws, the pool is left
+ * as it was.
+ * With a free-list policy other than lifo_free_list, the node is
+ * chosen by the policy, given the head, and given back if the ctor
+ * throws (the marks, which need the chain, are not available).
  */
-template <typename T, typename N>
-template <typename O>
-N stack_pool<T, N>::_push(O&& val, N head) {
-    if(empty(free_nodes)){
-        pool.emplace_back(std::forward<O>(val), head); 
-        return static_cast<stack_type>(pool.size());
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename... Args>
+N stack_pool<T, N, S, L, A, St, F>::_push(N head, Args&&... args) {
+    if constexpr(!F::chained){
+        auto x = static_cast<N>(free_list().template take_free<L::template node_size<T, N>>(head));
+        if(empty(x))
+            return append(head, std::forward<Args>(args)...);
+        try {
+            L::construct(pool, x - 1, std::forward<Args>(args)...);
+        } catch(...) {
+            free_list().give_free(x);
+            throw;
+        }
+        node(x).next = head;
+        if constexpr(St::enabled)
+            counters().on_push(true, pool.size() - counters().free_length + 1);
+        return x;
+    }else if(empty(free_nodes)){
+        return append(head, std::forward<Args>(args)...);
     }else{
         auto tmp = free_nodes;
-        free_nodes = next(free_nodes);
-        //pool[tmp-1] = node_t{std::forward<O>(val), head};
-        node(tmp) = node_t{std::forward<O>(val), head};
+        if(marks)
+            journal.emplace_back(tmp, node(tmp).next);
+        try {
+            L::construct(pool, tmp - 1, std::forward<Args>(args)...);
+        } catch(...) {
+            if(marks)
+                journal.pop_back();
+            throw;
+        }
+        set_free_nodes(node(tmp).next);
+        node(tmp).next = head;
+        if constexpr(St::enabled)
+            counters().on_push(true, pool.size() - counters().free_length + 1);
         return tmp;
     }
 };
 
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename... Args>
+N stack_pool<T, N, S, L, A, St, F>::append(N head, Args&&... args) {
+    if constexpr(sizeof(stack_type) < sizeof(size_type)){
+        if(pool.size() >= std::numeric_limits<stack_type>::max())
+            throw std::length_error("stack_pool: too many nodes for the index type N");
+    }
+    if constexpr(!F::chained)
+        free_list().reserve_free(pool.size() + 1);
+    auto old_capacity = capacity();
+    pool.emplace_back(head, std::forward<Args>(args)...);
+    if constexpr(St::enabled){
+        if(capacity() != old_capacity)
+            counters().on_grow();
+        counters().on_push(false, pool.size() - counters().free_length);
+    }
+    return static_cast<stack_type>(pool.size());
+};
+
 /*
  * stack_pool::pop throws an exception if the argument x
  * is not a valid index of the pool vector. 
@@ -318,15 +992,446 @@ N stack_pool<T, N>::_push(O&& val, N head) {
  * on an empty stack. The user should be inform that the stack
  * is empty. So in this case I may throw exception.
  *
+ * The value is destroyed right away (nothing to do if T is trivially
+ * destructible), so that the free nodes hold no resources.
  */
-template <typename T, typename N>
-N stack_pool<T, N>::pop(N x){
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+N stack_pool<T, N, S, L, A, St, F>::pop(N x){
     N tmp = next(x); // internally checks for logic error
-    next(x) = free_nodes;
-    free_nodes = x;
+    assert_unmarked(x);
+    L::destroy(pool, x - 1);
+    if constexpr(F::chained){
+        next(x) = free_nodes;
+        set_free_nodes(x);
+    }else
+        free_list().give_free(x);
+    counters().on_release(1);
+    return tmp;
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+N stack_pool<T, N, S, L, A, St, F>::pop_unchecked(N x){
+    N tmp = next_unchecked(x);
+    assert_unmarked(x);
+    L::destroy(pool, x - 1);
+    if constexpr(F::chained){
+        node(x).next = free_nodes;
+        set_free_nodes(x);
+    }else
+        free_list().give_free(x);
+    counters().on_release(1);
     return tmp;
 };
 
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+N stack_pool<T, N, S, L, A, St, F>::release(N first, N last) noexcept {
+    auto rest = node(last).next;
+    if constexpr(!std::is_trivially_destructible<T>::value || St::enabled || !F::chained){
+        std::size_t n = 0;
+        for(auto x = first; x != rest; x = node(x).next, ++n){
+            L::destroy(pool, x - 1);
+            if constexpr(!F::chained)
+                free_list().give_free(x);
+        }
+        counters().on_release(n);
+    }
+    if constexpr(F::chained){
+        node(last).next = free_nodes;
+        set_free_nodes(first);
+    }
+    return rest;
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+N stack_pool<T, N, S, L, A, St, F>::pop_n(N x, size_type k){
+    if(!k)
+        return x;
+    check_logic_error(x, "Requested pop_n on a stack that is too short");
+    assert_unmarked(x);
+    auto last = x;
+    for(size_type i = 1; i < k; ++i){
+        last = node(last).next;
+        check_logic_error(last, "Requested pop_n on a stack that is too short");
+        assert_unmarked(last);
+    }
+    return release(x, last);
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename I>
+N stack_pool<T, N, S, L, A, St, F>::push_range(I first, I last, N head){
+    size_type n;
+    stack_type bottom;
+    return push_counted(first, last, head, n, bottom);
+};
+
+/*
+ * The first node pushed is the first free node, or the first one
+ * appended if there was no free node.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename I>
+N stack_pool<T, N, S, L, A, St, F>::push_counted(I first, I last, N head, size_type& n, N& bottom){
+    auto x = head;
+    n = 0;
+    bottom = end();
+    try {
+        if constexpr(F::chained){
+            bottom = free_nodes;
+            push_free(first, last, x, n);
+        }else{
+            for(; first != last && has_free_nodes(); ++first, ++n){
+                x = _push(x, *first);
+                if(!n)
+                    bottom = x;
+            }
+        }
+        using category = typename std::iterator_traits<I>::iterator_category;
+        if constexpr(std::is_base_of<std::forward_iterator_tag, category>::value){
+            // grow geometrically, as emplace_back would do,
+            // otherwise many short ranges would cost a reallocation each
+            auto needed = pool.size() + static_cast<size_type>(std::distance(first, last));
+            auto old_capacity = capacity();
+            if(needed > old_capacity)
+                reserve(std::max(needed, 2 * old_capacity));
+            if constexpr(St::enabled){
+                if(capacity() != old_capacity)
+                    counters().on_grow();
+            }
+        }
+        if(!n)
+            bottom = static_cast<stack_type>(pool.size() + 1);
+        for(; first != last; ++first, ++n)
+            x = append(x, *first);
+    } catch(...) {
+        while(x != head) x = pop(x);
+        throw;
+    }
+    if(!n)
+        bottom = end();
+    return x;
+};
+
+/*
+ * The free nodes are taken in one walk of their chain, keeping their
+ * head in a local: it is stored once and the statistics are updated
+ * once. If a constructor throws, the free nodes restart from the node
+ * that failed and the nodes pushed so far stay on the stack x, which
+ * the caller pops.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename I>
+void stack_pool<T, N, S, L, A, St, F>::push_free(I& first, I last, N& x, size_type& n){
+    auto f = free_nodes;
+    try {
+        for(; first != last && f; ++first, ++n){
+            auto rest = node(f).next;
+            if(marks)
+                journal.emplace_back(f, rest);
+            try {
+                L::construct(pool, f - 1, *first);
+            } catch(...) {
+                if(marks)
+                    journal.pop_back();
+                throw;
+            }
+            node(f).next = x;
+            x = f;
+            f = rest;
+        }
+    } catch(...) {
+        set_free_nodes(f);
+        if constexpr(St::enabled)
+            counters().on_push(true, pool.size() - counters().free_length + n, n);
+        throw;
+    }
+    set_free_nodes(f);
+    if constexpr(St::enabled)
+        counters().on_push(true, pool.size() - counters().free_length + n, n);
+};
+
+/*
+ * push_counted counts the new nodes and tells the lowest of them,
+ * which is the last node if the stack was empty: no walk is needed.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename I>
+stack_handle<N> stack_pool<T, N, S, L, A, St, F>::push_range(I first, I last,
+                                                             const handle_type& h){
+    size_type n;
+    stack_type bottom;
+    auto x = push_counted(first, last, h.head, n, bottom);
+    return {x, h.size + n, empty(h) ? bottom : h.tail};
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+std::vector<N> stack_pool<T, N, S, L, A, St, F>::compact(){
+    static_assert(F::chained, "compact needs lifo_free_list");
+    const size_type n = pool.size();
+    std::vector<bool> is_head(n, true);
+    for(auto x = free_nodes; x; x = node(x).next)
+        is_head[x - 1] = false;
+    std::vector<bool> is_free{is_head};
+    is_free.flip();
+    for(size_type i = 0; i < n; ++i)
+        if(!is_free[i] && pool[i].next)
+            is_head[pool[i].next - 1] = false;
+
+    std::vector<stack_type> table(n + 1, end());
+    std::vector<stack_type> order; // old addresses, in the new order
+    for(size_type i = 0; i < n; ++i){
+        if(!is_head[i])
+            continue;
+        for(auto x = static_cast<stack_type>(i + 1); x && !table[x]; x = node(x).next){
+            order.push_back(x);
+            table[x] = static_cast<stack_type>(order.size());
+        }
+    }
+
+    container_type compacted(pool.get_allocator());
+    compacted.reserve(order.size());
+    for(auto x : order)
+        compacted.emplace_back(table[node(x).next], std::move_if_noexcept(node(x).value));
+    pool = std::move(compacted);
+    set_free_nodes(end());
+    counters().on_free_reset(0);
+    journal.clear(); // the marks are no longer valid
+    marks = 0;
+    return table;
+};
+
+/*
+ * The walk of a root stops at the first node already marked,
+ * so that a tail shared by two roots is visited once.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename R>
+auto stack_pool<T, N, S, L, A, St, F>::collect(const R& roots) -> size_type {
+    static_assert(F::chained, "collect needs lifo_free_list");
+    const size_type n = pool.size();
+    std::vector<bool> keep(n, false);
+    for(stack_type x : roots)
+        for(; x && !keep[x - 1]; x = node(x).next)
+            keep[x - 1] = true;
+
+    size_type free_count = 0;
+    for(auto x = free_nodes; x; x = node(x).next, ++free_count)
+        ;
+
+    auto head = end();
+    size_type unreachable = 0;
+    for(size_type i = n; i > 0; --i){
+        if(keep[i - 1])
+            continue;
+        L::destroy(pool, i - 1); // nothing to do if the node was free
+        pool[i - 1].next = head;
+        head = static_cast<stack_type>(i);
+        ++unreachable;
+    }
+    set_free_nodes(head);
+    counters().on_free_reset(unreachable);
+    journal.clear();
+    marks = 0;
+    return unreachable - free_count;
+};
+
+namespace detail {
+    template <typename C>
+    struct is_std_vector : std::false_type {};
+    template <typename E, typename A>
+    struct is_std_vector<std::vector<E, A>> : std::true_type {};
+
+    inline void write_bytes(std::ostream& os, const void* p, std::size_t n) {
+        if(!os.write(static_cast<const char*>(p), static_cast<std::streamsize>(n)))
+            throw std::runtime_error("stack_pool: cannot write the snapshot");
+    }
+    inline void read_bytes(std::istream& is, void* p, std::size_t n) {
+        if(!is.read(static_cast<char*>(p), static_cast<std::streamsize>(n)))
+            throw std::runtime_error("stack_pool: the snapshot is truncated");
+    }
+    // a next read from a snapshot of n nodes must be one of them or the end
+    template <typename N>
+    void check_next(N next, std::size_t n) {
+        if(static_cast<std::size_t>(next) > n)
+            throw std::runtime_error("stack_pool: the snapshot links a node out of range");
+    }
+}
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+snapshot_header stack_pool<T, N, S, L, A, St, F>::make_header(std::uint32_t format) const noexcept {
+    static_assert(F::chained, "save and load need lifo_free_list");
+    snapshot_header h{};
+    std::memcpy(h.magic, snapshot_header::stkpool_magic, sizeof(h.magic));
+    h.version = snapshot_header::current_version;
+    h.format = format;
+    h.node_size = format == snapshot_header::raw ? sizeof(aos_node<T, N>) : 0;
+    h.index_width = sizeof(N);
+    h.size = pool.size();
+    h.free_nodes = free_nodes;
+    return h;
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+snapshot_header stack_pool<T, N, S, L, A, St, F>::read_header(std::istream& is,
+                                                             std::uint32_t format) const {
+    snapshot_header h;
+    detail::read_bytes(is, &h, sizeof(h));
+    auto expected = make_header(format);
+    if(std::memcmp(h.magic, expected.magic, sizeof(h.magic)) != 0 ||
+       h.version != expected.version || h.format != format ||
+       h.node_size != expected.node_size || h.index_width != expected.index_width ||
+       h.size > std::numeric_limits<stack_type>::max() || h.free_nodes > h.size)
+        throw std::runtime_error("stack_pool: not a snapshot of this kind of pool");
+    return h;
+};
+
+/*
+ * The loaded nodes are moved in only at the end, so that a failure
+ * leaves the pool untouched; then the free nodes are counted for the
+ * statistics, if any.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+void stack_pool<T, N, S, L, A, St, F>::adopt(container_type&& loaded, N free) {
+    pool = std::move(loaded);
+    set_free_nodes(free);
+    journal.clear();
+    marks = 0;
+    if constexpr(St::enabled){
+        size_type n = 0;
+        for(auto x = free_nodes; x; x = node(x).next)
+            ++n;
+        counters().on_free_reset(n);
+    }
+};
+
+/*
+ * If the nodes are an array of aos_node, as with vector_storage and
+ * aos_layout, and aos_node has no padding, they are written at once.
+ * Otherwise they are copied in the same format in a buffer, which is
+ * written when full: every record is zeroed first, so that the
+ * padding does not carry uninitialized bytes into the snapshot.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+void stack_pool<T, N, S, L, A, St, F>::save(std::ostream& os) const {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be saved raw: give a serializer");
+    using record = aos_node<T, N>;
+    auto h = make_header(snapshot_header::raw);
+    detail::write_bytes(os, &h, sizeof(h));
+    const size_type n = pool.size();
+    if constexpr(std::is_same<const_nodes_view, const record*>::value &&
+                 std::has_unique_object_representations_v<record>){
+        if(n)
+            detail::write_bytes(os, storage_view(pool), n * sizeof(record));
+    }else{
+        constexpr size_type block = 4096;
+        std::vector<std::aligned_storage_t<sizeof(record), alignof(record)>> buffer(block);
+        for(size_type i = 0; i < n; i += block){
+            const auto k = std::min(block, n - i);
+            for(size_type j = 0; j < k; ++j){
+                std::memset(static_cast<void*>(&buffer[j]), 0, sizeof(record));
+                ::new (static_cast<void*>(&buffer[j])) record(pool[i + j].next, pool[i + j].value);
+            }
+            detail::write_bytes(os, buffer.data(), k * sizeof(record));
+        }
+    }
+};
+
+/*
+ * If the nodes are a std::vector of aos_node and T can be default
+ * constructed, the vector is resized and the nodes are read straight
+ * into it. Otherwise they are read in a buffer and appended.
+ * Every next is checked against the number of nodes, so that a corrupt
+ * snapshot cannot make the pool read or write out of its nodes.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+void stack_pool<T, N, S, L, A, St, F>::load(std::istream& is) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be loaded raw: give a serializer");
+    using record = aos_node<T, N>;
+    auto h = read_header(is, snapshot_header::raw);
+    const auto n = static_cast<size_type>(h.size);
+    container_type loaded(pool.get_allocator());
+    if constexpr(detail::is_std_vector<container_type>::value &&
+                 std::is_default_constructible<T>::value){
+        loaded.resize(n, record{end()});
+        if(n)
+            detail::read_bytes(is, loaded.data(), n * sizeof(record));
+        for(const auto& r : loaded)
+            detail::check_next(r.next, n);
+    }else{
+        loaded.reserve(n);
+        constexpr size_type block = 4096;
+        std::vector<std::aligned_storage_t<sizeof(record), alignof(record)>> buffer(block);
+        for(size_type i = 0; i < n; i += block){
+            const auto k = std::min(block, n - i);
+            detail::read_bytes(is, buffer.data(), k * sizeof(record));
+            auto r = std::launder(reinterpret_cast<const record*>(buffer.data()));
+            for(size_type j = 0; j < k; ++j){
+                detail::check_next(r[j].next, n);
+                loaded.emplace_back(r[j].next, r[j].value);
+            }
+        }
+    }
+    adopt(std::move(loaded), static_cast<stack_type>(h.free_nodes));
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename Write>
+void stack_pool<T, N, S, L, A, St, F>::save(std::ostream& os, Write write) const {
+    auto h = make_header(snapshot_header::serialized);
+    detail::write_bytes(os, &h, sizeof(h));
+    const size_type n = pool.size();
+    std::vector<bool> is_free(n, false);
+    for(auto x = free_nodes; x; x = node(x).next)
+        is_free[x - 1] = true;
+    for(size_type i = 0; i < n; ++i){
+        const stack_type next = pool[i].next;
+        const char live = !is_free[i];
+        detail::write_bytes(os, &next, sizeof(next));
+        detail::write_bytes(os, &live, 1);
+        if(live)
+            write(os, pool[i].value);
+    }
+    if(!os)
+        throw std::runtime_error("stack_pool: cannot write the snapshot");
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename Read>
+void stack_pool<T, N, S, L, A, St, F>::load(std::istream& is, Read read) {
+    auto h = read_header(is, snapshot_header::serialized);
+    const auto n = static_cast<size_type>(h.size);
+    container_type loaded(pool.get_allocator());
+    loaded.reserve(n);
+    for(size_type i = 0; i < n; ++i){
+        stack_type next;
+        char live;
+        detail::read_bytes(is, &next, sizeof(next));
+        detail::read_bytes(is, &live, 1);
+        detail::check_next(next, n);
+        if(live){
+            loaded.emplace_back(next, read(is));
+        }else{
+            loaded.emplace_back(next);
+            L::destroy(loaded, i);
+        }
+        if(!is)
+            throw std::runtime_error("stack_pool: the snapshot is truncated");
+    }
+    adopt(std::move(loaded), static_cast<stack_type>(h.free_nodes));
+};
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+pool_counters stack_pool<T, N, S, L, A, St, F>::stats() const noexcept {
+    static_assert(St::enabled, "stats() needs a pool with Stats = pool_stats");
+    constexpr std::size_t node_bytes = L::template node_size<T, N>;
+    const auto& c = counters();
+    const std::size_t live = pool.size() - c.free_length;
+    return pool_counters{{live, c.free_length, c.high_water, c.pushes, c.reuses,
+                          c.growths, c.pops, capacity() * node_bytes, live * node_bytes}};
+};
+
 /*
  * This method allows the user to print a stack in the pool.
  *
@@ -335,12 +1440,175 @@ N stack_pool<T, N>::pop(N x){
  * memory is running low, cout may throw because it
  * allocates new memory.
  */
-template <typename T, typename N>
-void stack_pool<T, N>::display_stack(N x) const {
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+void stack_pool<T, N, S, L, A, St, F>::display_stack(N x) const {
     while(x){
-        const auto& [val, next] = stack_pool::node(x);
-        std::cout << val << "," << next << " --> ";
+        std::cout << node(x).value << "," << node(x).next << " --> ";
         x = stack_pool::next(x);
     }
     std::cout << std::endl;
 };
+
+/*
+ * The reused nodes are given back their old next in reverse order,
+ * so a node reused more than once ends up with the next it had at
+ * the mark; destroying its value again is harmless, as pop leaves
+ * an empty slot. Then the appended nodes are dropped.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+void stack_pool<T, N, S, L, A, St, F>::rollback(const mark_type& m){
+    check_mark(m.id, "Requested rollback to a mark that is not the innermost active one");
+    for(auto i = journal.size(); i > m.journal; --i){
+        auto x = journal[i - 1].first;
+        L::destroy(pool, x - 1);
+        node(x).next = journal[i - 1].second;
+    }
+    journal.erase(journal.begin() + m.journal, journal.end());
+    while(pool.size() > m.size)
+        pool.pop_back();
+    set_free_nodes(m.free_nodes);
+    counters().on_free_reset(m.free_count);
+    commit(m);
+};
+
+/*
+ * The pieces are linked one after the other, then h is moved to the
+ * front, so that the stack of h reaches them all.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <std::size_t K>
+void stack_pool<T, N, S, L, A, St, F>::relink(N h, const N (&pieces)[K]) noexcept {
+    auto head = end(), tail = end();
+    for(auto x : pieces){
+        if(!x)
+            continue;
+        if(tail)
+            node(tail).next = x;
+        else
+            head = x;
+        for(tail = x; node(tail).next; tail = node(tail).next)
+            ;
+    }
+    if(head == h)
+        return;
+    auto prev = head;
+    while(node(prev).next != h)
+        prev = node(prev).next;
+    node(prev).next = node(h).next;
+    node(h).next = head;
+}
+
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+N stack_pool<T, N, S, L, A, St, F>::reverse(N x) noexcept {
+    auto r = end();
+    while(x){
+        auto rest = node(x).next;
+        node(x).next = r;
+        r = x;
+        x = rest;
+    }
+    return r;
+};
+
+/*
+ * tail is the last node of the merged stack so far:
+ * each node taken from a or b is linked after it.
+ * If cmp throws, the merged part (cut after tail) and what is left
+ * of a and b are relinked behind the first node of a.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename Compare>
+N stack_pool<T, N, S, L, A, St, F>::merge(N a, N b, Compare cmp){
+    const auto first = a;
+    auto head = end(), tail = end();
+    auto link = [this, &head, &tail](stack_type x) noexcept {
+        if(tail)
+            node(tail).next = x;
+        else
+            head = x;
+        tail = x;
+    };
+    try {
+        while(a && b){
+            if(cmp(node(b).value, node(a).value)){
+                link(b);
+                b = node(b).next;
+            }else{
+                link(a);
+                a = node(a).next;
+            }
+        }
+    } catch(...) {
+        if(tail)
+            node(tail).next = end();
+        relink(first, {head, a, b});
+        throw;
+    }
+    link(a ? a : b);
+    return head;
+};
+
+/*
+ * runs[i] is either empty or a sorted run of 2^i nodes, which were
+ * pushed before the nodes of runs[j] for j < i: merging an older run
+ * as the first argument keeps the sort stable.
+ * The second argument of each merge is cleared before the call, so
+ * that if cmp throws its nodes are only in the stack of the first one:
+ * then the runs, the carry and the rest of x are all relinked behind
+ * the first node of x.
+ */
+template <typename T, typename N, typename S, typename L, typename A, typename St, typename F>
+template <typename Compare>
+N stack_pool<T, N, S, L, A, St, F>::sort(N x, Compare cmp){
+    const auto first = x;
+    constexpr auto digits = std::numeric_limits<stack_type>::digits;
+    stack_type pieces[digits + 2] = {}; // the runs, then the carry and x
+    auto runs = pieces; // the first digits entries
+    auto& carry = pieces[digits];
+    try {
+        while(x){
+            carry = x;
+            x = node(x).next;
+            node(carry).next = end();
+            std::size_t i = 0;
+            for(; runs[i]; ++i){
+                carry = merge(runs[i], std::exchange(carry, end()), cmp);
+                runs[i] = end();
+            }
+            runs[i] = std::exchange(carry, end());
+        }
+        for(int i = 0; i < digits; ++i)
+            if(runs[i]){
+                x = merge(runs[i], std::exchange(x, end()), cmp);
+                runs[i] = end();
+            }
+    } catch(...) {
+        pieces[digits + 1] = x;
+        relink(first, pieces);
+        throw;
+    }
+    return x;
+};
+
+/*
+ * A stack_pool with the narrowest N able to address max_nodes nodes,
+ * e.g. narrow_stack_pool<int, 60000> has 2-byte addresses.
+ * The remaining parameters are the policies of stack_pool.
+ */
+template <typename T, std::size_t max_nodes, typename... Policies>
+using narrow_stack_pool = stack_pool<T, smallest_index_t<max_nodes>, Policies...>;
+
+/*
+ * A stack_pool whose nodes are allocated from a std::pmr::memory_resource,
+ * e.g. a std::pmr::monotonic_buffer_resource for short-lived pools.
+ * (It lives in namespace pmr, not std::pmr: we cannot add names to std.)
+ */
+namespace pmr {
+    template <typename T, typename N = std::size_t,
+              typename Storage = vector_storage, typename Layout = aos_layout,
+              typename Stats = no_stats, typename FreeList = lifo_free_list>
+    using stack_pool = ::stack_pool<T, N, Storage, Layout,
+                                    std::pmr::polymorphic_allocator<T>, Stats, FreeList>;
+}
+
+#endif // STACK_POOL_HPP
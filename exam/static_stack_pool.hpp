@@ -0,0 +1,240 @@
+#ifndef STATIC_STACK_POOL_HPP
+#define STATIC_STACK_POOL_HPP
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "stack_pool.hpp"
+
+/*
+ * A stack_pool of at most Capacity nodes, stored in a std::array
+ * inside the pool itself: it never allocates, and all of it can be
+ * used in constant expressions.
+ *
+ * N defaults to the narrowest unsigned type that can address
+ * Capacity nodes, e.g. a pool of 200 nodes uses 1-byte addresses.
+ *
+ * The interface is the one of stack_pool, with two differences:
+ * - push and emplace do not throw when the pool is full: they leave
+ *   the stack as it is and return its head unchanged, so that
+ *   l = pool.push(v, l) keeps l. try_push and try_emplace also tell
+ *   whether the value was pushed (full() tells it in advance);
+ * - the pool itself never throws: value, next and pop on an empty
+ *   stack are logic errors that are not checked. An exception thrown
+ *   by the construction or the assignment of T in push and emplace
+ *   goes through, leaving the pool as it was.
+ *
+ * Since a constexpr function cannot end the lifetime of an array
+ * element in C++17, the values are assigned, not constructed: T must
+ * be default constructible and assignable. A popped value that is not
+ * trivially destructible is reset to T{}, to free its resources.
+ */
+template <typename T, std::size_t Capacity, typename N = smallest_index_t<Capacity>>
+class static_stack_pool {
+    static_assert(std::is_unsigned<N>::value, "N must be an unsigned integer type");
+    static_assert(Capacity <= std::numeric_limits<N>::max(),
+                  "N cannot address Capacity nodes");
+    static_assert(std::is_default_constructible<T>::value,
+                  "static_stack_pool needs a default constructible T");
+
+    struct node_t {
+        T value{};
+        N next{};
+    };
+
+    /*
+     * See stack_pool::_stack
+     */
+    template <typename P>
+    class _stack {
+        P* pool_ptr;
+        N head;
+    public:
+        constexpr _stack(P* ptr, N x) noexcept
+            : pool_ptr{ptr}, head{x} {};
+        constexpr auto begin() const noexcept {
+            return pool_ptr->begin(head);
+        }
+        constexpr auto end() const noexcept {
+            return pool_ptr->end(head);
+        }
+    };
+
+    std::array<node_t, Capacity> pool{};
+    N used{0};       // nodes taken at least once
+    N free_nodes{0};
+
+    constexpr node_t& node(N x) noexcept {
+        return pool[x - 1];
+    }
+    constexpr const node_t& node(N x) const noexcept {
+        return pool[x - 1];
+    }
+
+public:
+    using stack_type = N;
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = _iterator<node_t*, T, N>;
+    using const_iterator = _iterator<const node_t*, const T, N>;
+
+    /*
+     * What try_push and try_emplace return: the head of the stack,
+     * the new one if the value was pushed, the old one otherwise.
+     */
+    struct push_result {
+        stack_type head;
+        bool pushed;
+    };
+
+    constexpr static_stack_pool() noexcept = default;
+
+    constexpr stack_type new_stack() const noexcept {
+        return end();
+    }
+
+    constexpr stack_type end() const noexcept {
+        return stack_type(0);
+    }
+
+    constexpr bool empty(stack_type x) const noexcept {
+        return x == end();
+    }
+
+    static constexpr size_type capacity() noexcept {
+        return Capacity;
+    }
+
+    /*
+     * True if the next push would fail.
+     */
+    constexpr bool full() const noexcept {
+        return empty(free_nodes) && used == Capacity;
+    }
+
+    constexpr T& value(stack_type x) noexcept {
+        return node(x).value;
+    }
+    constexpr const T& value(stack_type x) const noexcept {
+        return node(x).value;
+    }
+
+    constexpr stack_type& next(stack_type x) noexcept {
+        return node(x).next;
+    }
+    constexpr const stack_type& next(stack_type x) const noexcept {
+        return node(x).next;
+    }
+
+    /*
+     * Returns the new head, or head itself if the pool is full.
+     */
+    constexpr stack_type push(const T& val, stack_type head) {
+        return try_emplace(head, val).head;
+    }
+    constexpr stack_type push(T&& val, stack_type head) {
+        return try_emplace(head, std::move(val)).head;
+    }
+
+    template <typename... Args>
+    constexpr stack_type emplace(stack_type head, Args&&... args) {
+        return try_emplace(head, std::forward<Args>(args)...).head;
+    }
+
+    constexpr push_result try_push(const T& val, stack_type head) {
+        return try_emplace(head, val);
+    }
+    constexpr push_result try_push(T&& val, stack_type head) {
+        return try_emplace(head, std::move(val));
+    }
+
+    template <typename... Args>
+    constexpr push_result try_emplace(stack_type head, Args&&... args);
+
+    constexpr stack_type pop(stack_type x);
+
+    constexpr stack_type free_stack(stack_type x);
+
+    constexpr iterator begin(stack_type x) noexcept {
+        return iterator{x, pool.data()};
+    }
+    constexpr iterator end(stack_type) noexcept {
+        return iterator{0, pool.data()};
+    }
+
+    constexpr const_iterator begin(stack_type x) const noexcept {
+        return const_iterator{x, pool.data()};
+    }
+    constexpr const_iterator end(stack_type) const noexcept {
+        return const_iterator{0, pool.data()};
+    }
+
+    constexpr const_iterator cbegin(stack_type x) const noexcept {
+        return const_iterator{x, pool.data()};
+    }
+    constexpr const_iterator cend(stack_type) const noexcept {
+        return const_iterator{0, pool.data()};
+    }
+
+    constexpr auto stack(stack_type head) noexcept {
+        return _stack<static_stack_pool>{this, head};
+    }
+    constexpr auto stack(stack_type head) const noexcept {
+        return _stack<const static_stack_pool>{this, head};
+    }
+};
+
+/*
+ * The value is assigned before the pool is touched:
+ * if it throws, the pool is left as it was.
+ */
+template <typename T, std::size_t C, typename N>
+template <typename... Args>
+constexpr auto static_stack_pool<T, C, N>::try_emplace(N head, Args&&... args)
+    -> push_result {
+    N x = free_nodes;
+    if(empty(x)){
+        if(used == C)
+            return {head, false};
+        x = static_cast<N>(used + 1);
+        node(x).value = T(std::forward<Args>(args)...);
+        ++used;
+    }else{
+        node(x).value = T(std::forward<Args>(args)...);
+        free_nodes = node(x).next;
+    }
+    node(x).next = head;
+    return {x, true};
+};
+
+template <typename T, std::size_t C, typename N>
+constexpr N static_stack_pool<T, C, N>::pop(N x) {
+    N rest = node(x).next;
+    if constexpr(!std::is_trivially_destructible<T>::value)
+        node(x).value = T{};
+    node(x).next = free_nodes;
+    free_nodes = x;
+    return rest;
+};
+
+template <typename T, std::size_t C, typename N>
+constexpr N static_stack_pool<T, C, N>::free_stack(N x) {
+    if(empty(x))
+        return x;
+    auto tail = x;
+    for(;;){
+        if constexpr(!std::is_trivially_destructible<T>::value)
+            node(tail).value = T{};
+        if(empty(node(tail).next))
+            break;
+        tail = node(tail).next;
+    }
+    node(tail).next = free_nodes;
+    free_nodes = x;
+    return end();
+};
+
+#endif // STATIC_STACK_POOL_HPP
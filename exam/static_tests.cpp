@@ -0,0 +1,93 @@
+#include "catch.hpp"
+
+#include "static_stack_pool.hpp"
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <type_traits>
+
+namespace {
+  // the same code works on a stack_pool and on a static_stack_pool
+  template <typename P>
+  constexpr int push_and_sum(P& pool, int n) {
+    auto l = pool.new_stack();
+    for(int i = 1; i <= n; ++i)
+      l = pool.push(i, l);
+    l = pool.pop(l);
+    int sum = 0;
+    for(auto x : pool.stack(l))
+      sum += x;
+    return sum;
+  }
+
+  constexpr int constant_sum() {
+    static_stack_pool<int, 16> pool;
+    return push_and_sum(pool, 10);
+  }
+
+  constexpr bool overflow_is_reported() {
+    static_stack_pool<int, 3> pool;
+    auto l = pool.new_stack();
+    for(int i = 0; i < 3; ++i)
+      l = pool.push(i, l);
+    bool full = pool.full();
+    auto refused = pool.try_push(3, l);
+    bool kept = pool.push(4, l) == l && refused.head == l && !refused.pushed;
+    l = pool.pop(l);
+    bool room = !pool.full();
+    auto accepted = pool.try_push(3, l);
+    return full && kept && room && accepted.pushed && accepted.head == 3;
+  }
+
+  // on overflow the stack is kept, with the values pushed so far
+  constexpr int overflow_keeps_the_stack() {
+    static_stack_pool<int, 4> pool;
+    return push_and_sum(pool, 10);
+  }
+}
+
+static_assert(constant_sum() == 45, "static_stack_pool must work in constant expressions");
+static_assert(overflow_is_reported(), "a full static_stack_pool must report the overflow");
+static_assert(overflow_keeps_the_stack() == 6, "a full static_stack_pool must keep the stack");
+static_assert(std::is_same<static_stack_pool<int, 255>::stack_type, std::uint8_t>::value, "");
+static_assert(std::is_same<static_stack_pool<int, 256>::stack_type, std::uint16_t>::value, "");
+static_assert(std::is_same<static_stack_pool<int, 70000>::stack_type, std::uint32_t>::value, "");
+
+SCENARIO("a pool of fixed capacity"){
+  GIVEN("a static pool and a stack_pool"){
+    static_stack_pool<int, 64> spool;
+    stack_pool<int, std::uint8_t> pool;
+
+    THEN("the same code gives the same results"){
+      REQUIRE(push_and_sum(spool, 10) == push_and_sum(pool, 10));
+    }
+  }
+
+  GIVEN("a static pool of strings"){
+    static_stack_pool<std::string, 4> pool;
+    auto l1 = pool.new_stack();
+    auto l2 = pool.new_stack();
+    l1 = pool.push("a", l1);
+    l2 = pool.emplace(l2, 3, 'b');
+    l1 = pool.push("c", l1);
+    l2 = pool.push("d", l2);
+    REQUIRE(pool.full());
+    REQUIRE(pool.push("e", l1) == l1);
+    REQUIRE(!pool.try_emplace(l1, 1, 'e').pushed);
+    REQUIRE(pool.value(l2) == "d");
+
+    WHEN("a stack is freed"){
+      l1 = pool.free_stack(l1);
+
+      THEN("its nodes are reused and its values released"){
+        REQUIRE(!pool.full());
+        auto l3 = pool.push("e", pool.new_stack());
+        REQUIRE(l3 == 3); // the old head of l1
+        l3 = pool.push("f", l3);
+        REQUIRE(pool.full());
+        REQUIRE(std::accumulate(pool.cbegin(l2), pool.cend(l2), std::string{}) == "dbbb");
+        REQUIRE(std::accumulate(pool.cbegin(l3), pool.cend(l3), std::string{}) == "fe");
+      }
+    }
+  }
+}
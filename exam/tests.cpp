@@ -2,6 +2,13 @@
 
 #include "stack_pool.hpp"
 #include <algorithm> // max_element, min_element
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
 
 SCENARIO("getting confident with the addresses"){
   stack_pool<int, std::size_t> pool{16};
@@ -169,3 +176,1000 @@ SCENARIO("using iterators"){
   }
 
 }
+
+SCENARIO("storing the nodes in chunks"){
+  GIVEN("a pool with chunks of four nodes"){
+    stack_pool<int, std::size_t, chunked_storage<2>> pool{};
+    auto l = pool.new_stack();
+    l = pool.push(1, l);
+    const auto bottom = l;
+    auto& first = pool.value(bottom);
+
+    WHEN("the pool grows"){
+      for(int i = 2; i <= 10; ++i)
+        l = pool.push(i, l);
+
+      THEN("the capacity grows by whole chunks")
+        REQUIRE(pool.capacity() == 12);
+
+      THEN("the references to the values are still valid"){
+        REQUIRE(&first == &pool.value(bottom));
+        first = 42;
+        REQUIRE(*std::max_element(pool.begin(l), pool.end(l)) == 42);
+      }
+
+      THEN("the freed nodes are reused"){
+        l = pool.free_stack(l);
+        auto l2 = pool.new_stack();
+        for(int i = 0; i < 10; ++i)
+          l2 = pool.push(i, l2);
+        REQUIRE(pool.capacity() == 12);
+        REQUIRE(*std::min_element(pool.begin(l2), pool.end(l2)) == 0);
+      }
+
+      THEN("a copy of the pool holds the same stacks"){
+        const auto copy = pool;
+        REQUIRE(std::equal(copy.cbegin(l), copy.cend(l), pool.begin(l)));
+      }
+    }
+  }
+}
+
+SCENARIO("values and indices in separate arrays"){
+  GIVEN("a pool with the soa layout"){
+    stack_pool<char, std::size_t, vector_storage, soa_layout> pool{4};
+    auto l1 = pool.new_stack();
+    l1 = pool.push('a', l1);
+    l1 = pool.push('b', l1);
+    auto l2 = pool.new_stack();
+    l2 = pool.push('c', l2);
+
+    THEN("the stacks are the same as with the default layout"){
+      REQUIRE(pool.value(l1) == 'b');
+      REQUIRE(pool.value(pool.next(l1)) == 'a');
+      REQUIRE(pool.next(pool.next(l1)) == pool.end());
+      REQUIRE(std::string(pool.begin(l1), pool.end(l1)) == "ba");
+    }
+
+    WHEN("a stack is freed, its nodes are reused"){
+      l1 = pool.free_stack(l1);
+      l2 = pool.push('d', l2);
+      REQUIRE(l2 < 3); // one of the nodes of l1
+      REQUIRE(std::string(pool.cbegin(l2), pool.cend(l2)) == "dc");
+    }
+  }
+
+  GIVEN("the soa layout on chunked storage"){
+    stack_pool<std::string, uint16_t, chunked_storage<3>, soa_layout> pool{};
+    auto l = pool.new_stack();
+    for(int i = 0; i < 20; ++i)
+      l = pool.push(std::to_string(i), l);
+    REQUIRE(pool.capacity() == 24);
+    REQUIRE(*std::max_element(pool.begin(l), pool.end(l)) == "9");
+    l = pool.pop(l);
+    REQUIRE(pool.value(l) == "18");
+  }
+}
+
+struct counted {
+  static int alive;
+  int value;
+  counted(int v, int w) : value{v + w} { ++alive; }
+  counted(const counted& o) : value{o.value} { ++alive; }
+  counted(counted&& o) : value{o.value} { ++alive; }
+  ~counted() { --alive; }
+};
+int counted::alive = 0;
+
+SCENARIO("values are constructed in place and destroyed when popped"){
+  GIVEN("a pool of counted values"){
+    stack_pool<counted, uint16_t> pool{8};
+    auto l = pool.new_stack();
+    l = pool.emplace(l, 1, 2);
+    l = pool.emplace(l, 3, 4);
+    REQUIRE(counted::alive == 2);
+    REQUIRE(pool.value(l).value == 7);
+
+    WHEN("a node is popped, its value is gone"){
+      l = pool.pop(l);
+      REQUIRE(counted::alive == 1);
+
+      THEN("a new value takes its place"){
+        l = pool.emplace(l, 5, 6);
+        REQUIRE(counted::alive == 2);
+        REQUIRE(l == 2);
+        REQUIRE(pool.value(l).value == 11);
+      }
+    }
+
+    WHEN("the stack is freed, no value is left"){
+      l = pool.free_stack(l);
+      REQUIRE(counted::alive == 0);
+    }
+
+    WHEN("the pool grows, only the live values are moved"){
+      l = pool.pop(l);
+      auto l2 = pool.new_stack();
+      for(int i = 0; i < 20; ++i)
+        l2 = pool.emplace(l2, i, 0);
+      REQUIRE(counted::alive == 21);
+      auto copy = pool;
+      REQUIRE(counted::alive == 42);
+    }
+  }
+  REQUIRE(counted::alive == 0);
+
+  GIVEN("a pool of unique_ptr with the soa layout"){
+    stack_pool<std::unique_ptr<int>, std::size_t, vector_storage, soa_layout> pool{};
+    auto l = pool.new_stack();
+    l = pool.emplace(l, new int{42});
+    REQUIRE(*pool.value(l) == 42);
+    l = pool.pop(l);
+    REQUIRE(pool.empty(l));
+    l = pool.push(std::make_unique<int>(7), l);
+    REQUIRE(*pool.value(l) == 7);
+  }
+}
+
+SCENARIO("bulk operations"){
+  GIVEN("a pool and a range of values"){
+    stack_pool<int, uint16_t> pool{};
+    std::vector<int> v{1, 2, 3, 4, 5};
+
+    WHEN("we push the whole range"){
+      auto l = pool.push_range(v.begin(), v.end(), pool.new_stack());
+
+      THEN("the stack is the same as pushing one element at a time"){
+        auto l2 = pool.new_stack();
+        for(auto x : v)
+          l2 = pool.push(x, l2);
+        REQUIRE(std::equal(pool.begin(l), pool.end(l), pool.begin(l2), pool.end(l2)));
+        REQUIRE(pool.value(l) == 5);
+      }
+
+      THEN("the nodes are consecutive"){
+        REQUIRE(l == 5);
+        REQUIRE(pool.next(l) == 4);
+      }
+
+      THEN("pop_n removes the first k nodes"){
+        l = pool.pop_n(l, 3);
+        REQUIRE(pool.value(l) == 2);
+        REQUIRE_THROWS_AS(pool.pop_n(l, 3), std::out_of_range);
+        REQUIRE(pool.value(l) == 2);
+        l = pool.pop_n(l, 2);
+        REQUIRE(pool.empty(l));
+      }
+
+      THEN("a freed stack gives back all its nodes at once"){
+        auto capacity = pool.capacity();
+        l = pool.free_stack(l, 1);
+        REQUIRE(pool.empty(l));
+        l = pool.push_range(v.begin(), v.end(), l);
+        REQUIRE(pool.capacity() == capacity);
+        REQUIRE(pool.value(l) == 5);
+        l = pool.free_stack(l);
+        REQUIRE(pool.empty(l));
+      }
+    }
+
+    WHEN("a constructor throws in the middle of the range"){
+      stack_pool<counted, uint16_t> cpool{};
+      auto l = cpool.new_stack();
+      l = cpool.emplace(l, 0, 0);
+      struct thrower {
+        int i;
+        operator counted() const {
+          if(i == 3) throw std::runtime_error("three");
+          return counted{i, 0};
+        }
+      };
+      std::vector<thrower> t{{1}, {2}, {3}, {4}};
+      REQUIRE_THROWS_AS(cpool.push_range(t.begin(), t.end(), l), std::runtime_error);
+
+      THEN("the stack is left as it was"){
+        REQUIRE(cpool.value(l).value == 0);
+        REQUIRE(cpool.next(l) == cpool.end());
+        REQUIRE(counted::alive == 1);
+      }
+    }
+
+    WHEN("a constructor throws while the free nodes are reused"){
+      stack_pool<counted, uint16_t, vector_storage, aos_layout,
+                 std::allocator<counted>, pool_stats> cpool{};
+      auto l = cpool.new_stack();
+      for(int i = 0; i < 6; ++i)
+        l = cpool.emplace(l, i, 0);
+      l = cpool.pop_n(l, 5); // five free nodes
+      auto capacity = cpool.capacity();
+      struct thrower {
+        int i;
+        operator counted() const {
+          if(i == 3) throw std::runtime_error("three");
+          return counted{i, 0};
+        }
+      };
+      std::vector<thrower> t{{1}, {2}, {3}, {4}};
+      REQUIRE_THROWS_AS(cpool.push_range(t.begin(), t.end(), l), std::runtime_error);
+
+      THEN("the nodes pushed so far go back to the free nodes"){
+        REQUIRE(cpool.value(l).value == 0);
+        REQUIRE(cpool.next(l) == cpool.end());
+        REQUIRE(counted::alive == 1);
+        auto stats = cpool.stats();
+        REQUIRE(stats[pool_counters::live] == 1);
+        REQUIRE(stats[pool_counters::free] == 5);
+        for(int i = 0; i < 5; ++i)
+          l = cpool.emplace(l, i, 0);
+        REQUIRE(cpool.capacity() == capacity);
+      }
+    }
+  }
+}
+
+SCENARIO("compacting the pool"){
+  GIVEN("three stacks whose nodes are interleaved"){
+    stack_pool<int, uint16_t> pool{};
+    auto l1 = pool.new_stack();
+    auto l2 = pool.new_stack();
+    auto l3 = pool.new_stack();
+    for(int i = 0; i < 10; ++i){
+      l1 = pool.push(i, l1);
+      l2 = pool.push(10 + i, l2);
+      l3 = pool.push(20 + i, l3);
+    }
+    l2 = pool.free_stack(l2);
+    l1 = pool.pop_n(l1, 5);
+    std::vector<int> v1(pool.begin(l1), pool.end(l1));
+    std::vector<int> v3(pool.begin(l3), pool.end(l3));
+
+    WHEN("the pool is compacted"){
+      auto table = pool.compact();
+      l1 = table[l1];
+      l3 = table[l3];
+
+      THEN("the stacks hold the same values"){
+        REQUIRE(v1 == std::vector<int>(pool.begin(l1), pool.end(l1)));
+        REQUIRE(v3 == std::vector<int>(pool.begin(l3), pool.end(l3)));
+      }
+
+      THEN("every stack is stored in consecutive nodes"){
+        for(auto l : {l1, l3})
+          for(auto x = l; pool.next(x) != pool.end(); x = pool.next(x))
+            REQUIRE(pool.next(x) == x + 1);
+      }
+
+      THEN("only the live nodes are left"){
+        REQUIRE(pool.capacity() == 15);
+        REQUIRE(table[pool.end()] == pool.end());
+        auto l2 = pool.push(42, pool.new_stack());
+        REQUIRE(l2 == 16);
+      }
+    }
+  }
+}
+
+namespace {
+  // a memory_resource that counts the bytes it hands out
+  struct counting_resource : std::pmr::memory_resource {
+    std::size_t allocated{0};
+    std::size_t outstanding{0};
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+      allocated += bytes;
+      outstanding += bytes;
+      return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+      outstanding -= bytes;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+      return this == &o;
+    }
+  };
+}
+
+SCENARIO("pools with a custom allocator"){
+  GIVEN("a memory resource"){
+    counting_resource resource;
+
+    WHEN("a pmr pool is filled"){
+      {
+        pmr::stack_pool<int, uint16_t> pool{16, &resource};
+        auto l = pool.new_stack();
+        for(int i = 0; i < 100; ++i)
+          l = pool.push(i, l);
+        REQUIRE(pool.value(l) == 99);
+        REQUIRE(pool.get_allocator().resource() == &resource);
+
+        THEN("the nodes come from the resource"){
+          REQUIRE(resource.allocated >= 100 * 2 * sizeof(int));
+        }
+
+        THEN("a copy uses the default resource, as std::pmr containers do"){
+          auto copy = pool;
+          REQUIRE(copy.get_allocator().resource() == std::pmr::get_default_resource());
+          REQUIRE(copy.value(l) == 99);
+        }
+
+        THEN("a moved pool keeps the resource"){
+          auto moved = std::move(pool);
+          REQUIRE(moved.get_allocator().resource() == &resource);
+          REQUIRE(moved.value(l) == 99);
+        }
+      }
+      THEN("everything is given back"){
+        REQUIRE(resource.outstanding == 0);
+      }
+    }
+
+    WHEN("the chunked storage and the soa layout are used"){
+      {
+        pmr::stack_pool<std::string, std::size_t, chunked_storage<4>, soa_layout> pool{&resource};
+        auto l = pool.new_stack();
+        for(int i = 0; i < 100; ++i)
+          l = pool.push(std::to_string(i), l);
+        REQUIRE(pool.value(l) == "99");
+        REQUIRE(resource.allocated > 0);
+
+        pmr::stack_pool<std::string, std::size_t, chunked_storage<4>, soa_layout> other{&resource};
+        other = std::move(pool);
+        REQUIRE(other.value(l) == "99");
+
+        counting_resource another;
+        pmr::stack_pool<std::string, std::size_t, chunked_storage<4>, soa_layout> far{&another};
+        far = other;
+        REQUIRE(far.value(l) == "99");
+        REQUIRE(far.get_allocator().resource() == &another);
+        REQUIRE(another.allocated > 0);
+      }
+      THEN("everything is given back"){
+        REQUIRE(resource.outstanding == 0);
+      }
+    }
+  }
+}
+
+SCENARIO("keeping statistics of the pool"){
+  GIVEN("a pool that counts its traffic"){
+    using pool_t = stack_pool<int, uint16_t, vector_storage, aos_layout,
+                              std::allocator<int>, pool_stats>;
+    pool_t pool{4};
+    auto l = pool.new_stack();
+    for(int i = 0; i < 6; ++i)
+      l = pool.push(i, l);
+
+    THEN("the pushes and the growths are counted"){
+      auto s = pool.stats();
+      REQUIRE(s[pool_counters::pushes] == 6);
+      REQUIRE(s[pool_counters::reuses] == 0);
+      REQUIRE(s[pool_counters::growths] == 1);
+      REQUIRE(s[pool_counters::live] == 6);
+      REQUIRE(s[pool_counters::free] == 0);
+      REQUIRE(s[pool_counters::bytes_used] == 6 * sizeof(aos_node<int, uint16_t>));
+      REQUIRE(s[pool_counters::bytes_reserved] ==
+              pool.capacity() * sizeof(aos_node<int, uint16_t>));
+    }
+
+    WHEN("nodes are popped, freed and reused"){
+      l = pool.pop(l);
+      l = pool.pop_n(l, 2);
+      auto m = pool.new_stack();
+      m = pool.push(10, m);
+      m = pool.push(11, m);
+      l = pool.free_stack(l);
+
+      THEN("the free nodes and the high water mark are tracked"){
+        auto s = pool.stats();
+        REQUIRE(s[pool_counters::pops] == 6);
+        REQUIRE(s[pool_counters::reuses] == 2);
+        REQUIRE(s[pool_counters::live] == 2);
+        REQUIRE(s[pool_counters::free] == 4);
+        REQUIRE(s[pool_counters::high_water] == 6);
+      }
+
+      THEN("compact empties the free nodes"){
+        pool.compact();
+        auto s = pool.stats();
+        REQUIRE(s[pool_counters::free] == 0);
+        REQUIRE(s[pool_counters::live] == 2);
+      }
+    }
+  }
+
+  GIVEN("an empty pool filled by push_range"){
+    using pool_t = stack_pool<int, uint16_t, vector_storage, aos_layout,
+                              std::allocator<int>, pool_stats>;
+    pool_t pool;
+    std::vector<int> v(1000, 7);
+    auto l = pool.push_range(v.begin(), v.end(), pool.new_stack());
+
+    THEN("the reservation of the range is counted as a growth"){
+      auto s = pool.stats();
+      REQUIRE(pool.capacity() >= 1000);
+      REQUIRE(s[pool_counters::growths] == 1);
+      REQUIRE(s[pool_counters::pushes] == 1000);
+      REQUIRE(s[pool_counters::live] == 1000);
+      REQUIRE(pool.value(l) == 7);
+    }
+  }
+
+  GIVEN("a pool without statistics"){
+    THEN("nothing is stored for them"){
+      REQUIRE(sizeof(stack_pool<int>) ==
+              sizeof(stack_pool<int, std::size_t, vector_storage, aos_layout,
+                                std::allocator<int>, pool_stats>) - sizeof(pool_stats));
+    }
+  }
+}
+
+SCENARIO("unchecked accessors"){
+  GIVEN("a stack with two nodes"){
+    stack_pool<int, uint16_t> pool;
+    auto l = pool.new_stack();
+    l = pool.push(1, l);
+    l = pool.push(2, l);
+
+    THEN("they agree with the checked ones"){
+      REQUIRE(pool.value_unchecked(l) == pool.value(l));
+      REQUIRE(pool.next_unchecked(l) == pool.next(l));
+      pool.value_unchecked(l) = 3;
+      REQUIRE(pool.value(l) == 3);
+    }
+
+    WHEN("the stack is popped"){
+      l = pool.pop_unchecked(l);
+      l = pool.pop_unchecked(l);
+      THEN("the nodes are reused as with pop"){
+        REQUIRE(pool.empty(l));
+        l = pool.push(4, l);
+        REQUIRE(l == 1);
+      }
+    }
+
+#ifndef NDEBUG
+    THEN("in debug builds end() and invalid nodes are still caught"){
+      REQUIRE_THROWS_AS(pool.value_unchecked(pool.end()), std::out_of_range);
+      REQUIRE_THROWS_AS(pool.next_unchecked(3), std::out_of_range);
+      REQUIRE_THROWS_AS(pool.pop_unchecked(pool.end()), std::out_of_range);
+    }
+#endif
+  }
+}
+
+SCENARIO("stacks that know their size"){
+  GIVEN("a stack handle"){
+    stack_pool<int, uint16_t> pool;
+    auto h = pool.new_handle();
+    REQUIRE(pool.empty(h));
+    REQUIRE(pool.size(h) == 0);
+    REQUIRE_THROWS_AS(pool.back(h), std::out_of_range);
+
+    WHEN("values are pushed"){
+      for(int i = 1; i <= 5; ++i)
+        h = pool.push(i, h);
+
+      THEN("size and back are O(1)"){
+        REQUIRE(pool.size(h) == 5);
+        REQUIRE(pool.value(h) == 5);
+        REQUIRE(pool.back(h) == 1);
+        auto raw = pool.make_handle(h.head);
+        REQUIRE(raw.size == h.size);
+        REQUIRE(raw.tail == h.tail);
+      }
+
+      THEN("pop keeps them up to date"){
+        h = pool.pop(h);
+        h = pool.pop_n(h, 3);
+        REQUIRE(pool.size(h) == 1);
+        REQUIRE(pool.back(h) == 1);
+        h = pool.pop(h);
+        REQUIRE(pool.empty(h));
+        REQUIRE(pool.empty(h.tail));
+      }
+
+      THEN("two stacks are concatenated in O(1)"){
+        std::vector<int> v{6, 7, 8};
+        auto g = pool.push_range(v.begin(), v.end(), pool.new_handle());
+        REQUIRE(pool.size(g) == 3);
+        REQUIRE(pool.back(g) == 6);
+        g = pool.push_range(v.begin(), v.end(), g);
+        REQUIRE(pool.size(g) == 6);
+        REQUIRE(pool.back(g) == 6);
+
+        auto c = pool.concat(h, g);
+        REQUIRE(pool.size(c) == 11);
+        REQUIRE(pool.value(c) == 5);
+        REQUIRE(pool.back(c) == 6);
+        REQUIRE(std::distance(pool.begin(c.head), pool.end(c.head)) == 11);
+
+        c = pool.free_stack(c);
+        REQUIRE(pool.empty(c));
+        auto l = pool.push(0, pool.new_stack());
+        REQUIRE(l == 5); // the whole chain went back to the free nodes
+
+        std::vector<int> w(13);
+        std::iota(w.begin(), w.end(), 100);
+        auto d = pool.push_range(w.begin(), w.end(), pool.new_handle()); // 10 free, 3 new
+        REQUIRE(pool.size(d) == 13);
+        REQUIRE(pool.back(d) == 100);
+        REQUIRE(pool.value(d) == 112);
+        auto raw = pool.make_handle(d.head);
+        REQUIRE(raw.size == d.size);
+        REQUIRE(raw.tail == d.tail);
+      }
+    }
+  }
+}
+
+SCENARIO("reordering the nodes of a stack"){
+  GIVEN("a stack of strings"){
+    stack_pool<std::string, uint16_t> pool;
+    std::vector<std::string> v{"d", "a", "c", "e", "b", "a"};
+    auto l = pool.push_range(v.begin(), v.end(), pool.new_stack());
+    std::vector<const std::string*> addresses;
+    for(auto& x : pool.stack(l))
+      addresses.push_back(&x);
+    auto content = [&pool](uint16_t x){
+      return std::vector<std::string>(pool.begin(x), pool.end(x));
+    };
+
+    THEN("reverse relinks the nodes"){
+      auto r = pool.reverse(l);
+      REQUIRE(content(r) == v);
+      REQUIRE(&pool.value(r) == addresses.back());
+    }
+
+    THEN("sort relinks the nodes in order, without moving the values"){
+      auto s = pool.sort(l);
+      REQUIRE(content(s) == std::vector<std::string>{"a", "a", "b", "c", "d", "e"});
+      REQUIRE(&pool.value(s) == addresses.front()); // the last "a" pushed
+      s = pool.sort(s, std::greater<>{});
+      REQUIRE(content(s) == std::vector<std::string>{"e", "d", "c", "b", "a", "a"});
+    }
+
+    THEN("sort is stable"){
+      stack_pool<std::pair<int, int>, uint16_t> pairs;
+      auto p = pairs.new_stack();
+      for(int i = 0; i < 100; ++i)
+        p = pairs.push({i % 7, i}, p);
+      p = pairs.sort(p, [](const auto& a, const auto& b){ return a.first < b.first; });
+      std::vector<std::pair<int, int>> sorted(pairs.begin(p), pairs.end(p));
+      REQUIRE(std::is_sorted(sorted.begin(), sorted.end(), [](const auto& a, const auto& b){
+        return a.first < b.first || (a.first == b.first && a.second > b.second);
+      }));
+    }
+
+    THEN("two sorted stacks are merged"){
+      std::vector<std::string> w{"f", "b"};
+      auto h1 = pool.sort(pool.make_handle(l));
+      auto h2 = pool.push_range(w.begin(), w.end(), pool.new_handle());
+      auto m = pool.merge(h1, h2);
+      REQUIRE(content(m.head) == std::vector<std::string>{"a", "a", "b", "b", "c", "d", "e", "f"});
+      REQUIRE(pool.size(m) == 8);
+      REQUIRE(pool.back(m) == "f");
+      REQUIRE(pool.back(pool.reverse(m)) == "a");
+    }
+
+    THEN("if the comparison throws, no node is lost"){
+      auto sorted_content = [&content](uint16_t x){
+        auto c = content(x);
+        std::sort(c.begin(), c.end());
+        return c;
+      };
+      int calls = 0, k = 0;
+      auto cmp = [&calls, &k](const std::string& a, const std::string& b){
+        if(calls++ == k)
+          throw std::runtime_error("compare");
+        return a < b;
+      };
+
+      for(bool thrown = true; thrown; ++k){
+        calls = 0;
+        try {
+          l = pool.sort(l, cmp);
+          thrown = false;
+        } catch(const std::runtime_error&) {}
+        REQUIRE(sorted_content(l) == std::vector<std::string>{"a", "a", "b", "c", "d", "e"});
+      }
+      REQUIRE(content(l) == std::vector<std::string>{"a", "a", "b", "c", "d", "e"});
+
+      std::vector<std::string> w{"f", "b"};
+      auto l2 = pool.push_range(w.begin(), w.end(), pool.new_stack());
+      calls = 0;
+      k = 2;
+      REQUIRE_THROWS_AS(pool.merge(l, l2, cmp), std::runtime_error);
+      REQUIRE(sorted_content(l) ==
+              std::vector<std::string>{"a", "a", "b", "b", "c", "d", "e", "f"});
+    }
+  }
+}
+
+SCENARIO("rolling back to a mark"){
+  GIVEN("a pool with some stacks and some free nodes"){
+    stack_pool<std::string, uint16_t, vector_storage, aos_layout,
+               std::allocator<std::string>, pool_stats> pool;
+    auto l1 = pool.new_stack();
+    auto l2 = pool.new_stack();
+    for(int i = 0; i < 4; ++i){
+      l1 = pool.push("l1 " + std::to_string(i), l1);
+      l2 = pool.push("l2 " + std::to_string(i), l2);
+    }
+    l2 = pool.pop_n(l2, 2); // two free nodes
+    const auto n = pool.size(pool.make_handle(l1)) + pool.size(pool.make_handle(l2));
+    auto before = pool.stats();
+
+    WHEN("nodes are pushed, popped and reused after the mark"){
+      auto m = pool.mark();
+      auto l3 = pool.new_stack();
+      for(int i = 0; i < 10; ++i){
+        l1 = pool.push("tmp", l1);
+        l3 = pool.push("tmp", l3);
+      }
+      l3 = pool.pop_n(l3, 5);
+      l2 = pool.push("tmp", l2);
+      l3 = pool.free_stack(l3);
+
+      THEN("rollback restores the pool as it was at the mark"){
+        pool.rollback(m);
+        l1 = 7; // the heads of the mark
+        l2 = 4;
+        REQUIRE(pool.value(l1) == "l1 3");
+        REQUIRE(pool.value(l2) == "l2 1");
+        REQUIRE(std::distance(pool.begin(l1), pool.end(l1)) == 4);
+        REQUIRE(std::distance(pool.begin(l2), pool.end(l2)) == 2);
+        auto after = pool.stats();
+        REQUIRE(after[pool_counters::live] == n);
+        REQUIRE(after[pool_counters::free] == before[pool_counters::free]);
+
+        auto x = pool.push("new", pool.new_stack());
+        auto y = pool.push("new", x);
+        REQUIRE(x == 8); // the free nodes are the same, in the same order
+        REQUIRE(y == 6);
+        REQUIRE_THROWS_AS(pool.rollback(m), std::out_of_range);
+      }
+    }
+
+    WHEN("marks are nested"){
+      auto outer = pool.mark();
+      l1 = pool.push("outer", l1);
+      auto inner = pool.mark();
+      l1 = pool.push("inner", l1);
+      pool.commit(inner);
+      REQUIRE(pool.value(l1) == "inner");
+
+      THEN("the outer rollback undoes the committed inner mark too"){
+        pool.rollback(outer);
+        REQUIRE(pool.stats()[pool_counters::live] == n);
+      }
+    }
+
+    WHEN("a mark is used out of order or after it is gone"){
+      auto h1 = l1; // the head at the outer mark
+      auto outer = pool.mark();
+      l1 = pool.push("outer", l1);
+      auto inner = pool.mark();
+      l1 = pool.push("inner", l1);
+      pool.rollback(inner);
+      l1 = pool.push("outer again", l1);
+
+      THEN("only the innermost active mark is accepted"){
+        REQUIRE_THROWS_AS(pool.rollback(inner), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.commit(inner), std::out_of_range);
+        REQUIRE(pool.value(l1) == "outer again");
+
+        auto again = pool.mark();
+        REQUIRE_THROWS_AS(pool.rollback(outer), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.commit(outer), std::out_of_range);
+        pool.commit(again);
+        pool.rollback(outer);
+        l1 = h1;
+        REQUIRE(pool.value(l1) == "l1 3");
+        REQUIRE(pool.stats()[pool_counters::live] == n);
+      }
+    }
+
+#ifndef NDEBUG
+    WHEN("a node that was live at the mark is popped"){
+      auto m = pool.mark();
+      l1 = pool.push("new", l1);
+      l2 = pool.push("reused", l2); // a node that was free at the mark
+
+      THEN("in debug builds the pop is refused"){
+        REQUIRE_THROWS_AS(pool.pop_n(l1, 2), std::logic_error);
+        REQUIRE(pool.value(l1) == "new");
+        l1 = pool.pop(l1);
+        REQUIRE_THROWS_AS(pool.pop(l1), std::logic_error);
+        REQUIRE_THROWS_AS(pool.pop_unchecked(l1), std::logic_error);
+        l2 = pool.pop(l2);
+        REQUIRE_THROWS_AS(pool.pop(l2), std::logic_error);
+        pool.rollback(m);
+        REQUIRE(pool.value(l1) == "l1 3");
+        REQUIRE(pool.stats()[pool_counters::live] == n);
+      }
+
+      THEN("in debug builds free_stack and concat are refused too"){
+        REQUIRE_THROWS_AS(pool.free_stack(l1), std::logic_error);
+        auto h1 = pool.make_handle(l1);
+        REQUIRE_THROWS_AS(pool.free_stack(h1), std::logic_error);
+        REQUIRE_THROWS_AS(pool.concat(h1, pool.make_handle(l2)), std::logic_error);
+        REQUIRE(std::distance(pool.begin(l1), pool.end(l1)) == 5);
+        auto l3 = pool.push("after", pool.new_stack());
+        auto h3 = pool.concat(pool.make_handle(l3), h1); // l3 comes after the mark
+        REQUIRE(pool.size(h3) == 6);
+        pool.rollback(m);
+        REQUIRE(pool.stats()[pool_counters::live] == n);
+      }
+
+      THEN("the nodes pushed before an inner mark are free again once it is committed"){
+        auto inner = pool.mark();
+        REQUIRE_THROWS_AS(pool.pop(l1), std::logic_error);
+        pool.commit(inner);
+        l1 = pool.pop(l1);
+        REQUIRE(pool.value(l1) == "l1 3");
+        pool.commit(m);
+        l1 = pool.pop(l1);
+        REQUIRE(pool.value(l1) == "l1 2");
+      }
+    }
+#endif
+  }
+}
+
+SCENARIO("the addresses must fit in N"){
+  GIVEN("a pool with 1-byte addresses"){
+    narrow_stack_pool<int, 200> pool;
+    static_assert(std::is_same<decltype(pool.new_stack()), std::uint8_t>::value, "");
+    auto l = pool.new_stack();
+    for(int i = 0; i < 255; ++i)
+      l = pool.push(i, l);
+    REQUIRE(l == 255);
+
+    THEN("one more node is refused, and the stacks are untouched"){
+      REQUIRE_THROWS_AS(pool.push(255, l), std::length_error);
+      std::vector<int> v{1, 2};
+      REQUIRE_THROWS_AS(pool.push_range(v.begin(), v.end(), l), std::length_error);
+      REQUIRE(pool.value(l) == 254);
+      REQUIRE(std::distance(pool.begin(l), pool.end(l)) == 255);
+    }
+
+    THEN("the free nodes can still be reused"){
+      l = pool.pop(l);
+      l = pool.push(-1, l);
+      REQUIRE(l == 255);
+      REQUIRE(pool.value(l) == -1);
+    }
+  }
+}
+
+SCENARIO("collecting the nodes of lost stacks"){
+  GIVEN("a pool where some stacks are lost"){
+    stack_pool<std::shared_ptr<int>, uint16_t, vector_storage, aos_layout,
+               std::allocator<std::shared_ptr<int>>, pool_stats> pool;
+    auto tracker = std::make_shared<int>(0);
+    auto kept = pool.new_stack();
+    auto lost = pool.new_stack();
+    for(int i = 0; i < 10; ++i){
+      kept = pool.push(tracker, kept);
+      lost = pool.push(tracker, lost);
+    }
+    auto other = pool.push(tracker, pool.new_stack());
+    other = pool.free_stack(other); // one free node
+    lost = pool.new_stack(); // its head is lost
+    REQUIRE(tracker.use_count() == 21);
+
+    WHEN("the pool is collected"){
+      auto reclaimed = pool.collect({kept});
+
+      THEN("the unreachable nodes are free again"){
+        REQUIRE(reclaimed == 10);
+        REQUIRE(tracker.use_count() == 11);
+        REQUIRE(std::distance(pool.begin(kept), pool.end(kept)) == 10);
+        REQUIRE(pool.stats()[pool_counters::free] == 11);
+        REQUIRE(pool.stats()[pool_counters::live] == 10);
+        REQUIRE(pool.push(tracker, pool.new_stack()) == 2); // lowest address first
+      }
+
+      THEN("collecting again reclaims nothing"){
+        std::vector<uint16_t> roots{kept, kept};
+        REQUIRE(pool.collect(roots) == 0);
+        REQUIRE(std::distance(pool.begin(kept), pool.end(kept)) == 10);
+      }
+    }
+  }
+}
+
+SCENARIO("saving and loading a snapshot"){
+  GIVEN("a pool with stacks and free nodes"){
+    stack_pool<double, uint32_t> pool;
+    auto l1 = pool.new_stack();
+    auto l2 = pool.new_stack();
+    for(int i = 0; i < 10000; ++i){
+      l1 = pool.push(i, l1);
+      l2 = pool.push(-i, l2);
+    }
+    l2 = pool.pop_n(l2, 100);
+    std::stringstream ss;
+    pool.save(ss);
+
+    THEN("the loaded pool has the same stacks, at the same addresses"){
+      stack_pool<double, uint32_t> other;
+      other.load(ss);
+      REQUIRE(other.value(l1) == 9999);
+      REQUIRE(other.value(l2) == -9899);
+      REQUIRE(std::equal(pool.begin(l1), pool.end(l1), other.begin(l1), other.end(l1)));
+      REQUIRE(other.push(0, other.new_stack()) == pool.push(0, pool.new_stack()));
+    }
+
+    THEN("a pool with a different layout can load it"){
+      stack_pool<double, uint32_t, chunked_storage<6>, soa_layout, std::allocator<double>,
+                 pool_stats> other;
+      other.load(ss);
+      REQUIRE(std::distance(other.begin(l2), other.end(l2)) == 9900);
+      REQUIRE(other.stats()[pool_counters::free] == 100);
+      std::stringstream again;
+      other.save(again);
+      REQUIRE(again.str() == ss.str()); // the padding of the nodes is zeroed
+      stack_pool<double, uint32_t> back;
+      back.load(again);
+      REQUIRE(std::equal(pool.begin(l1), pool.end(l1), back.begin(l1), back.end(l1)));
+    }
+
+    THEN("a snapshot of another kind of pool is refused"){
+      stack_pool<double, uint16_t> narrow;
+      auto l = narrow.push(1, narrow.new_stack());
+      REQUIRE_THROWS_AS(narrow.load(ss), std::runtime_error);
+      REQUIRE(narrow.value(l) == 1);
+      std::stringstream truncated{ss.str().substr(0, 100)};
+      stack_pool<double, uint32_t> other;
+      REQUIRE_THROWS_AS(other.load(truncated), std::runtime_error);
+    }
+
+    THEN("a snapshot that links a node out of range is refused"){
+      aos_node<double, uint32_t> r{0, 0.0};
+      const auto next_offset = reinterpret_cast<char*>(&r.next) - reinterpret_cast<char*>(&r);
+      auto bytes = ss.str();
+      const uint32_t bad = 20001;
+      std::memcpy(&bytes[sizeof(snapshot_header) + 5000 * sizeof(r) + next_offset], &bad,
+                  sizeof(bad));
+      stack_pool<double, uint32_t> other;
+      std::stringstream corrupt{bytes};
+      REQUIRE_THROWS_AS(other.load(corrupt), std::runtime_error);
+      stack_pool<double, uint32_t, chunked_storage<6>, soa_layout> chunked;
+      std::stringstream again{bytes};
+      REQUIRE_THROWS_AS(chunked.load(again), std::runtime_error);
+    }
+  }
+
+  GIVEN("a pool of strings"){
+    stack_pool<std::string, uint16_t> pool;
+    auto l = pool.new_stack();
+    for(int i = 0; i < 100; ++i)
+      l = pool.push(std::to_string(i), l);
+    l = pool.pop(l);
+    std::stringstream ss;
+    pool.save(ss, [](std::ostream& os, const std::string& s){
+      os << s.size() << ' ' << s;
+    });
+
+    THEN("it is saved and loaded through a serializer"){
+      stack_pool<std::string, uint16_t> other;
+      other.load(ss, [](std::istream& is){
+        std::size_t n;
+        is >> n;
+        is.get();
+        std::string s(n, ' ');
+        is.read(&s[0], n);
+        return s;
+      });
+      REQUIRE(other.value(l) == "98");
+      REQUIRE(std::distance(other.begin(l), other.end(l)) == 99);
+      REQUIRE(other.push("new", other.new_stack()) == 100);
+    }
+
+    THEN("a next out of range is refused"){
+      auto bytes = ss.str();
+      const uint16_t bad = 101;
+      std::memcpy(&bytes[sizeof(snapshot_header)], &bad, sizeof(bad));
+      std::stringstream corrupt{bytes};
+      stack_pool<std::string, uint16_t> other;
+      REQUIRE_THROWS_AS(other.load(corrupt, [](std::istream& is){
+        std::size_t n;
+        is >> n;
+        is.get();
+        std::string s(n, ' ');
+        is.read(&s[0], n);
+        return s;
+      }), std::runtime_error);
+    }
+  }
+}
+
+SCENARIO("choosing the free node to reuse"){
+  GIVEN("a pool with free nodes spread around"){
+    using pool_type = stack_pool<std::string, uint32_t, vector_storage, aos_layout,
+                                 std::allocator<std::string>, pool_stats, ordered_free_list>;
+    pool_type pool;
+    auto a = pool.new_stack();
+    auto b = pool.new_stack();
+    for(int i = 0; i < 100; ++i){
+      a = pool.push(std::to_string(i), a);
+      b = pool.push(std::to_string(-i), b);
+    }
+    a = pool.pop_n(a, 10);  // nodes 199, 197, ..., 181
+    b = pool.free_stack(b); // the even nodes
+    REQUIRE(pool.stats()[pool_counters::free] == 110);
+
+    THEN("ordered_free_list takes the lowest address first"){
+      auto c = pool.new_stack();
+      for(int i = 0; i < 110; ++i){
+        c = pool.push("c", c);
+        REQUIRE(c == uint32_t(i < 90 ? 2 * i + 2 : i + 91));
+      }
+      REQUIRE(pool.stats()[pool_counters::free] == 0);
+      REQUIRE(pool.push("new", c) == 201);
+      REQUIRE(pool.value(a) == "89");
+      REQUIRE(std::distance(pool.begin(c), pool.end(c)) == 110);
+    }
+
+    THEN("push_range uses the free nodes before appending"){
+      std::vector<std::string> v(111, "x");
+      auto c = pool.push_range(v.begin(), v.end(), pool.new_stack());
+      REQUIRE(c == 201);
+      REQUIRE(pool.next(c) == 200);
+      REQUIRE(pool.stats()[pool_counters::live] == 201);
+    }
+  }
+
+  GIVEN("a pool that prefers the block of the head"){
+    // nodes of 8 bytes: a block of 64 bytes holds the addresses 1-8, 9-16...
+    stack_pool<uint32_t, uint32_t, vector_storage, aos_layout, std::allocator<uint32_t>,
+               no_stats, near_head_free_list<64>> pool;
+    std::vector<uint32_t> heads(4, pool.new_stack());
+    for(uint32_t i = 0; i < 64; ++i)
+      heads[i % 4] = pool.push(i, heads[i % 4]);
+    heads[0] = pool.pop(heads[0]); // 61
+    heads[1] = pool.pop(heads[1]); // 62
+    heads[2] = pool.free_stack(heads[2]); // 3, 7, ..., 63
+
+    THEN("a push takes a free node in the block of its head"){
+      auto x = heads[3];
+      for(uint32_t expected : {59, 61, 62, 63, 3}){
+        x = pool.push(0, x);
+        REQUIRE(x == expected);
+      }
+      REQUIRE(std::distance(pool.begin(x), pool.end(x)) == 21);
+    }
+
+    THEN("a new stack starts from the lowest free node"){
+      auto x = pool.new_stack();
+      for(uint32_t expected : {3, 7, 11, 15}){
+        x = pool.push(0, x);
+        REQUIRE(x == expected);
+      }
+    }
+  }
+
+  GIVEN("an ordered pool larger than a word of the top of its bitmap"){
+    // a word of the top level covers 64 * 64 * 64 = 2^18 nodes
+    stack_pool<uint32_t, uint32_t, vector_storage, aos_layout, std::allocator<uint32_t>,
+               no_stats, ordered_free_list> pool;
+    const uint32_t n = (1u << 19) + 100;
+    auto l = pool.new_stack();
+    for(uint32_t i = 0; i < n; ++i)
+      l = pool.push(i, l);
+    l = pool.pop_n(l, 3); // n, n - 1, n - 2
+
+    THEN("the lowest free node is found across the words of the top"){
+      const uint32_t k = 1u << 18;
+      l = pool.pop_n(l, k); // the free nodes span two words of the top
+      auto x = pool.push(0, pool.new_stack());
+      REQUIRE(x == n - 2 - k);
+      l = pool.free_stack(l);
+      x = pool.push(0, x);
+      REQUIRE(x == 1);
+      x = pool.push(0, x);
+      REQUIRE(x == 2);
+    }
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef TIMER_HPP
+#define TIMER_HPP
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+/*
+ * Same timer used in c++/10_efficient_programming, with elapsed()
+ * returning the seconds instead of printing them, so that the
+ * benchmarks can turn them into throughputs.
+ */
+template <typename Clock = std::chrono::steady_clock,
+          typename Duration = typename Clock::duration>
+class timer {
+    using time_point = std::chrono::time_point<Clock, Duration>;
+    time_point t0;
+
+public:
+    void start() { t0 = Clock::now(); }
+    double elapsed() const {
+        return std::chrono::duration_cast<std::chrono::duration<double>>(
+                   Clock::now() - t0).count();
+    }
+    void stop() {
+        std::cout << std::setw(15) << elapsed() << " [seconds]" << std::endl;
+    }
+};
+
+#endif // TIMER_HPP
@@ -0,0 +1,350 @@
+#ifndef UNROLLED_STACK_POOL_HPP
+#define UNROLLED_STACK_POOL_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "stack_pool.hpp"
+
+/*
+ * A node of an unrolled stack: up to K values and their number.
+ * The values are kept in an anonymous union, so that only the first
+ * count of them are alive; values[count - 1] is the top of the block.
+ *
+ * For trivially copyable T the block is trivially copyable too,
+ * otherwise copy, move and destruction deal with the live values only.
+ */
+template <typename T, std::size_t K, bool = std::is_trivially_copyable<T>::value>
+struct unrolled_block {
+    using count_type = smallest_index_t<K>;
+
+    union {
+        T values[K];
+    };
+    count_type count;
+
+    unrolled_block() noexcept : count{0} {}
+
+    template <typename... Args>
+    void construct(Args&&... args) {
+        ::new (static_cast<void*>(&values[count])) T(std::forward<Args>(args)...);
+        ++count;
+    }
+    void destroy() noexcept {
+        --count;
+    }
+};
+
+template <typename T, std::size_t K>
+struct unrolled_block<T, K, false> {
+    using count_type = smallest_index_t<K>;
+
+    union {
+        T values[K];
+    };
+    count_type count;
+
+    unrolled_block() noexcept : count{0} {}
+
+    unrolled_block(const unrolled_block& o) : count{0} {
+        append(o);
+    }
+    unrolled_block(unrolled_block&& o) noexcept(std::is_nothrow_move_constructible<T>::value)
+        : count{0} {
+        append(std::move(o));
+    }
+
+    unrolled_block& operator=(const unrolled_block& o) {
+        if(this != &o){
+            clear();
+            append(o);
+        }
+        return *this;
+    }
+    unrolled_block& operator=(unrolled_block&& o) noexcept(
+        std::is_nothrow_move_constructible<T>::value) {
+        if(this != &o){
+            clear();
+            append(std::move(o));
+        }
+        return *this;
+    }
+
+    ~unrolled_block() {
+        clear();
+    }
+
+    template <typename... Args>
+    void construct(Args&&... args) {
+        ::new (static_cast<void*>(&values[count])) T(std::forward<Args>(args)...);
+        ++count;
+    }
+    void destroy() noexcept {
+        values[--count].~T();
+    }
+
+private:
+    void clear() noexcept {
+        while(count)
+            destroy();
+    }
+
+    /*
+     * If a constructor throws, the values copied so far are destroyed
+     * by whoever owns this block.
+     */
+    template <typename B>
+    void append(B&& o) {
+        for(count_type i = 0; i < o.count; ++i){
+            if constexpr(std::is_lvalue_reference<B>::value)
+                construct(o.values[i]);
+            else
+                construct(std::move(o.values[i]));
+        }
+    }
+};
+
+/*
+ * Iterates over the values of an unrolled stack, from the top:
+ * within a block the values are contiguous and visited backwards,
+ * the next of a block is followed only when the block is exhausted.
+ *
+ * It holds the pool of the blocks, the current block and the
+ * position (plus one) of the current value in it: end is block 0,
+ * position 0.
+ */
+template <typename pool_t, typename T, typename N>
+class _unrolled_iterator {
+    using block_type =
+        std::remove_reference_t<decltype(std::declval<pool_t&>().value_unchecked(N{1}))>;
+
+    pool_t* pool;
+    block_type* block;
+    N current;
+    std::size_t pos;
+
+public:
+    using value_type = T;
+    using pointer = value_type*;
+    using reference = value_type&;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    _unrolled_iterator(pool_t* p, N x) noexcept
+        : pool{p}, block{nullptr}, current{x}, pos{0} {
+        if(x){
+            block = &pool->value_unchecked(x);
+            pos = block->count;
+        }
+    }
+
+    reference operator*() const {
+        return block->values[pos - 1];
+    }
+    _unrolled_iterator& operator++() {
+        if(--pos == 0){
+            current = pool->next_unchecked(current);
+            if(current){
+                block = &pool->value_unchecked(current);
+                pos = block->count;
+            }
+        }
+        return *this;
+    }
+    _unrolled_iterator operator++(int){
+        auto tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+    friend bool operator==(const _unrolled_iterator& a, const _unrolled_iterator& b) noexcept {
+        return a.current == b.current && a.pos == b.pos;
+    }
+    friend bool operator!=(const _unrolled_iterator& a, const _unrolled_iterator& b) noexcept {
+        return !(a == b);
+    }
+};
+
+/*
+ * A pool of stacks whose nodes hold up to K values each.
+ *
+ * push and pop work inside the head node until it is full or empty,
+ * so only one push in K allocates a node and one pop in K frees it,
+ * and walking a stack follows a next every K values: the values in
+ * between are read sequentially.
+ * K = 1 is a stack_pool (with a count in each node).
+ *
+ * The nodes are kept in a stack_pool of unrolled_block, so they are
+ * reused in the same way; a stack is the address of its head node.
+ */
+template <typename T, std::size_t K, typename N = std::size_t>
+class unrolled_stack_pool {
+    static_assert(K > 0, "a node must hold at least one value");
+
+    using block_type = unrolled_block<T, K>;
+    using pool_type = stack_pool<block_type, N>;
+    pool_type pool;
+
+    /*
+     * See stack_pool::_stack
+     */
+    template <typename P>
+    class _stack {
+        P* pool_ptr;
+        N head;
+    public:
+        _stack(P* ptr, N x) noexcept
+            : pool_ptr{ptr}, head{x} {};
+        auto begin() const noexcept {
+            return pool_ptr->begin(head);
+        }
+        auto end() const noexcept {
+            return pool_ptr->end(head);
+        }
+    };
+
+    void check_logic_error(N x, const char* message) const {
+        if(empty(x))
+            throw std::out_of_range(message);
+    }
+
+public:
+    using stack_type = N;
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = _unrolled_iterator<pool_type, T, N>;
+    using const_iterator = _unrolled_iterator<const pool_type, const T, N>;
+
+    static constexpr size_type values_per_node = K;
+
+    unrolled_stack_pool() = default;
+
+    /*
+     * Room for n values.
+     */
+    explicit unrolled_stack_pool(size_type n) {
+        reserve(n);
+    }
+
+    void reserve(size_type n) {
+        pool.reserve((n + K - 1) / K);
+    }
+
+    size_type capacity() const noexcept {
+        return pool.capacity() * K;
+    }
+
+    stack_type new_stack() const noexcept {
+        return end();
+    }
+
+    stack_type end() const noexcept {
+        return stack_type(0);
+    }
+
+    bool empty(stack_type x) const noexcept {
+        return x == end();
+    }
+
+    /*
+     * The value on top of the stack x.
+     */
+    T& value(stack_type x) {
+        check_logic_error(x, "Requested value on empty stack");
+        auto& b = pool.value_unchecked(x);
+        return b.values[b.count - 1];
+    }
+    const T& value(stack_type x) const {
+        check_logic_error(x, "Requested value on empty stack");
+        auto& b = pool.value_unchecked(x);
+        return b.values[b.count - 1];
+    }
+
+    stack_type push(const T& val, stack_type head) {
+        return emplace(head, val);
+    }
+    stack_type push(T&& val, stack_type head) {
+        return emplace(head, std::move(val));
+    }
+
+    /*
+     * Returns the new head: head itself, unless its node is full.
+     */
+    template <typename... Args>
+    stack_type emplace(stack_type head, Args&&... args);
+
+    /*
+     * Returns the new head: x itself, unless its node becomes empty.
+     * It throws std::out_of_range if x is empty.
+     */
+    stack_type pop(stack_type x);
+
+    stack_type free_stack(stack_type x) noexcept {
+        return pool.free_stack(x);
+    }
+
+    iterator begin(stack_type x) noexcept {
+        return iterator{&pool, x};
+    }
+    iterator end(stack_type) noexcept {
+        return iterator{&pool, end()};
+    }
+
+    const_iterator begin(stack_type x) const noexcept {
+        return const_iterator{&pool, x};
+    }
+    const_iterator end(stack_type) const noexcept {
+        return const_iterator{&pool, end()};
+    }
+
+    const_iterator cbegin(stack_type x) const noexcept {
+        return begin(x);
+    }
+    const_iterator cend(stack_type x) const noexcept {
+        return end(x);
+    }
+
+    auto stack(stack_type head) noexcept {
+        return _stack<unrolled_stack_pool>{this, head};
+    }
+    auto stack(stack_type head) const noexcept {
+        return _stack<const unrolled_stack_pool>{this, head};
+    }
+};
+
+/*
+ * If the constructor of T throws in a new node, the node is popped:
+ * the pool is left as it was.
+ */
+template <typename T, std::size_t K, typename N>
+template <typename... Args>
+N unrolled_stack_pool<T, K, N>::emplace(N head, Args&&... args) {
+    if(!empty(head)){
+        auto& b = pool.value_unchecked(head);
+        if(b.count < K){
+            b.construct(std::forward<Args>(args)...);
+            return head;
+        }
+    }
+    auto x = pool.emplace(head);
+    try {
+        pool.value_unchecked(x).construct(std::forward<Args>(args)...);
+    } catch(...) {
+        pool.pop_unchecked(x);
+        throw;
+    }
+    return x;
+};
+
+template <typename T, std::size_t K, typename N>
+N unrolled_stack_pool<T, K, N>::pop(N x) {
+    check_logic_error(x, "Requested pop on empty stack");
+    auto& b = pool.value_unchecked(x);
+    b.destroy();
+    return b.count ? x : pool.pop_unchecked(x);
+};
+
+#endif // UNROLLED_STACK_POOL_HPP
@@ -0,0 +1,84 @@
+#include "catch.hpp"
+
+#include "unrolled_stack_pool.hpp"
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+SCENARIO("stacks with several values per node"){
+  GIVEN("an unrolled pool with 4 values per node"){
+    unrolled_stack_pool<int, 4, std::uint16_t> pool;
+    auto l = pool.new_stack();
+    for(int i = 1; i <= 10; ++i)
+      l = pool.push(i, l);
+
+    THEN("a node is taken every 4 values"){
+      REQUIRE(l == 3);
+      REQUIRE(pool.value(l) == 10);
+      REQUIRE(pool.capacity() >= 12);
+    }
+
+    THEN("the iterators go through the nodes transparently"){
+      std::vector<int> v(pool.begin(l), pool.end(l));
+      REQUIRE(v == std::vector<int>{10, 9, 8, 7, 6, 5, 4, 3, 2, 1});
+      int sum = 0;
+      for(auto x : pool.stack(l))
+        sum += x;
+      REQUIRE(sum == 55);
+    }
+
+    WHEN("values are popped"){
+      for(int i = 0; i < 2; ++i)
+        l = pool.pop(l);
+      REQUIRE(l == 2);
+      REQUIRE(pool.value(l) == 8);
+
+      THEN("the empty node is reused by the next stack"){
+        auto m = pool.push(0, pool.new_stack());
+        REQUIRE(m == 3);
+        REQUIRE(std::distance(pool.cbegin(l), pool.cend(l)) == 8);
+      }
+
+      THEN("popping everything gives an empty stack"){
+        while(!pool.empty(l))
+          l = pool.pop(l);
+        REQUIRE_THROWS_AS(pool.pop(l), std::out_of_range);
+        REQUIRE_THROWS_AS(pool.value(l), std::out_of_range);
+      }
+    }
+  }
+
+  GIVEN("values that own resources"){
+    auto tracker = std::make_shared<int>(0);
+    {
+      unrolled_stack_pool<std::shared_ptr<int>, 3> pool;
+      auto l1 = pool.new_stack();
+      auto l2 = pool.new_stack();
+      for(int i = 0; i < 20; ++i){
+        l1 = pool.push(tracker, l1);
+        l2 = pool.emplace(l2, tracker);
+      }
+      REQUIRE(tracker.use_count() == 41);
+      l1 = pool.pop(l1);
+      REQUIRE(tracker.use_count() == 40);
+      l1 = pool.free_stack(l1);
+      REQUIRE(tracker.use_count() == 21);
+
+      auto copy = pool;
+      REQUIRE(tracker.use_count() == 41);
+      REQUIRE(std::distance(copy.begin(l2), copy.end(l2)) == 20);
+    }
+    REQUIRE(tracker.use_count() == 1);
+  }
+
+  GIVEN("strings in nodes of one value"){
+    unrolled_stack_pool<std::string, 1> pool;
+    auto l = pool.new_stack();
+    for(int i = 0; i < 100; ++i)
+      l = pool.push(std::to_string(i), l);
+    REQUIRE(pool.value(l) == "99");
+    REQUIRE(std::distance(pool.begin(l), pool.end(l)) == 100);
+  }
+}